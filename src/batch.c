@@ -0,0 +1,249 @@
+/** @file
+  Implementacja wsadowego wykonywania skryptów kalkulatora
+  w procesach roboczych.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "batch.h"
+#include "calc.h"
+
+/**
+ * To jest struktura przechowująca listę ścieżek skryptów do wykonania.
+ */
+typedef struct ScriptList {
+    char **paths; ///< ścieżki skryptów
+    size_t count; ///< liczba skryptów
+    size_t capacity; ///< na ile ścieżek została zaalokowana pamięć
+} ScriptList;
+
+/**
+ * Zwraca napis będący sklejeniem dwóch napisów.
+ * W przypadku błędu funkcji malloc, kończy wykonywanie programu z kodem 1.
+ * @param[in] a : początek
+ * @param[in] b : koniec
+ * @return nowo zaalokowany napis
+ */
+static char *Concat(const char *a, const char *b) {
+    size_t a_length = strlen(a), b_length = strlen(b);
+    char *result = malloc(a_length + b_length + 1);
+    if (result == NULL)
+        exit(1);
+    memcpy(result, a, a_length);
+    memcpy(result + a_length, b, b_length + 1);
+    return result;
+}
+
+/**
+ * Sprawdza, czy napis kończy się podanym sufiksem.
+ * @param[in] s : napis
+ * @param[in] suffix : sufiks
+ * @return czy @p s kończy się @p suffix
+ */
+static bool EndsWith(const char *s, const char *suffix) {
+    size_t length = strlen(s), suffix_length = strlen(suffix);
+    return length >= suffix_length &&
+           strcmp(s + length - suffix_length, suffix) == 0;
+}
+
+/**
+ * Dopisuje ścieżkę do listy, przejmując ją na własność.
+ * @param[in,out] list : lista skryptów
+ * @param[in] path : zaalokowana na stercie ścieżka
+ */
+static void ListAppend(ScriptList *list, char *path) {
+    if (list->count == list->capacity) {
+        list->capacity = 1 + 2 * list->capacity;
+        list->paths = realloc(list->paths, list->capacity * sizeof(char *));
+        if (list->paths == NULL)
+            exit(1);
+    }
+    list->paths[list->count++] = path;
+}
+
+/**
+ * Porównuje ścieżki alfabetycznie, dla funkcji qsort.
+ * @param[in] a : wskaźnik na ścieżkę
+ * @param[in] b : wskaźnik na ścieżkę
+ * @return wynik porównania
+ */
+static int PathComparator(const void *a, const void *b) {
+    return strcmp(*(char *const *) a, *(char *const *) b);
+}
+
+/**
+ * Dopisuje do listy wszystkie zwykłe pliki z katalogu, w kolejności
+ * alfabetycznej, pomijając pliki ukryte i pliki z wynikami.
+ * @param[in,out] list : lista skryptów
+ * @param[in] directory : ścieżka katalogu
+ * @return czy udało się odczytać katalog
+ */
+static bool ListDirectory(ScriptList *list, const char *directory) {
+    DIR *dir = opendir(directory);
+    if (dir == NULL)
+        return false;
+
+    size_t first = list->count;
+    char *prefix = Concat(directory, "/");
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.' ||
+            EndsWith(entry->d_name, BATCH_OUTPUT_SUFFIX) ||
+            EndsWith(entry->d_name, BATCH_ERROR_SUFFIX))
+            continue;
+
+        char *path = Concat(prefix, entry->d_name);
+        struct stat info;
+        if (stat(path, &info) == 0 && S_ISREG(info.st_mode)) {
+            ListAppend(list, path);
+        } else {
+            free(path);
+        }
+    }
+    free(prefix);
+    closedir(dir);
+
+    qsort(list->paths + first, list->count - first, sizeof(char *),
+          PathComparator);
+    return true;
+}
+
+/**
+ * Przekierowuje deskryptor na podany plik.
+ * @param[in] path : ścieżka pliku
+ * @param[in] flags : flagi funkcji open
+ * @param[in] target : przekierowywany deskryptor
+ * @return czy się udało
+ */
+static bool Redirect(const char *path, int flags, int target) {
+    int fd = open(path, flags, 0666);
+    if (fd < 0)
+        return false;
+    bool success = dup2(fd, target) >= 0;
+    close(fd);
+    return success;
+}
+
+/**
+ * Treść procesu roboczego: przekierowuje standardowe wejście i wyjścia
+ * na pliki skryptu i wykonuje skrypt. Nie wraca.
+ * @param[in] path : ścieżka skryptu
+ * @param[in] options : opcje wykonywania
+ */
+static void RunScript(const char *path, const CalcOptions *options) {
+    char *output = Concat(path, BATCH_OUTPUT_SUFFIX);
+    char *error = Concat(path, BATCH_ERROR_SUFFIX);
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+
+    if (!Redirect(path, O_RDONLY, STDIN_FILENO) ||
+        !Redirect(output, flags, STDOUT_FILENO) ||
+        !Redirect(error, flags, STDERR_FILENO)) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        _exit(1);
+    }
+    free(output);
+    free(error);
+
+    RunCalculator(options);
+    exit(0);
+}
+
+/**
+ * Czeka na zakończenie dowolnego procesu roboczego.
+ * @param[in] list : lista skryptów
+ * @param[in] pids : identyfikatory procesów kolejnych skryptów
+ * @return czy proces zakończył się poprawnie
+ */
+static bool WaitForScript(const ScriptList *list, const pid_t pids[]) {
+    int status;
+    pid_t pid;
+    do {
+        pid = wait(&status);
+    } while (pid < 0 && errno == EINTR);
+    if (pid < 0)
+        return false;
+
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+        return true;
+    for (size_t i = 0; i < list->count; i++) {
+        if (pids[i] == pid) {
+            fprintf(stderr, "%s: script failed\n", list->paths[i]);
+        }
+    }
+    return false;
+}
+
+long ProcessorCount(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? count : 1;
+}
+
+int RunBatch(char *paths[], int count, long jobs, const CalcOptions *options) {
+    ScriptList list = {NULL, 0, 0};
+    int result = 0;
+
+    for (int i = 0; i < count; i++) {
+        struct stat info;
+        if (stat(paths[i], &info) != 0) {
+            fprintf(stderr, "%s: %s\n", paths[i], strerror(errno));
+            result = 1;
+        } else if (S_ISDIR(info.st_mode)) {
+            if (!ListDirectory(&list, paths[i])) {
+                fprintf(stderr, "%s: %s\n", paths[i], strerror(errno));
+                result = 1;
+            }
+        } else {
+            ListAppend(&list, Concat(paths[i], ""));
+        }
+    }
+
+    pid_t *pids = calloc(list.count + 1, sizeof(pid_t));
+    if (pids == NULL)
+        exit(1);
+    // dzieci nie mogą odziedziczyć niewypisanych danych
+    fflush(NULL);
+
+    long running = 0;
+    for (size_t i = 0; i < list.count; i++) {
+        if (running == jobs) {
+            if (!WaitForScript(&list, pids))
+                result = 1;
+            running--;
+        }
+        pids[i] = fork();
+        if (pids[i] < 0) {
+            fprintf(stderr, "%s: %s\n", list.paths[i], strerror(errno));
+            result = 1;
+        } else if (pids[i] == 0) {
+            RunScript(list.paths[i], options);
+        } else {
+            running++;
+        }
+    }
+    while (running > 0) {
+        if (!WaitForScript(&list, pids))
+            result = 1;
+        running--;
+    }
+
+    for (size_t i = 0; i < list.count; i++) {
+        free(list.paths[i]);
+    }
+    free(list.paths);
+    free(pids);
+    return result;
+}
@@ -0,0 +1,45 @@
+/** @file
+  Wsadowe wykonywanie wielu niezależnych skryptów kalkulatora.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdbool.h>
+#include "calc.h"
+
+/**
+ * Rozszerzenie pliku, do którego trafia standardowe wyjście skryptu.
+ */
+#define BATCH_OUTPUT_SUFFIX ".out"
+
+/**
+ * Rozszerzenie pliku, do którego trafia wyjście błędów skryptu.
+ */
+#define BATCH_ERROR_SUFFIX ".err"
+
+/**
+ * Wykonuje skrypty kalkulatora z podanych plików oraz ze wszystkich plików
+ * z podanych katalogów (z pominięciem plików ukrytych i wyników).
+ * Każdy skrypt wykonywany jest w osobnym procesie roboczym, z własnym stosem,
+ * a naraz działa co najwyżej @p jobs procesów.
+ * Standardowe wyjście skryptu X trafia do pliku X.out,
+ * a wyjście błędów do pliku X.err.
+ * @param[in] paths : ścieżki plików i katalogów
+ * @param[in] count : liczba ścieżek
+ * @param[in] jobs : maksymalna liczba równocześnie działających procesów
+ * @param[in] options : opcje wykonywania skryptów
+ * @return 0, jeśli wszystkie skrypty wykonały się poprawnie, 1 w.p.p.
+ */
+int RunBatch(char *paths[], int count, long jobs, const CalcOptions *options);
+
+/**
+ * Zwraca liczbę dostępnych procesorów (co najmniej 1).
+ * @return liczba procesorów
+ */
+long ProcessorCount(void);
+
+#endif //BATCH_H
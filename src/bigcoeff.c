@@ -0,0 +1,320 @@
+/** @file
+  Implementacja wolnej ścieżki współczynników wariantu POLY_COEFF_BIG:
+  liczb całkowitych, które nie mieszczą się w typie long.
+
+  Duża liczba przechowywana jest jako znak i wartość bezwzględna zapisana
+  cyframi w systemie o podstawie @f$2^{32}@f$. Każda funkcja zwracająca
+  współczynnik normalizuje wynik: jeśli mieści się w typie long,
+  zwracany jest mały współczynnik, a pamięć dużej liczby jest zwalniana.
+  Dzięki temu równość małego i dużego współczynnika jest zawsze fałszywa,
+  a zero ma jedną postać.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include "poly.h"
+#include "mallocs.h"
+#include "input_output.h"
+
+/** Liczba bitów jednej cyfry. */
+#define LIMB_BITS 32
+
+/** Liczba cyfr wartości bezwzględnej liczby typu long. */
+#define SMALL_LIMBS 2
+
+/** Podstawa, przez którą dzielimy przy zamianie na zapis dziesiętny. */
+#define DECIMAL_CHUNK 1000000000U
+
+/** Liczba cyfr dziesiętnych w DECIMAL_CHUNK. */
+#define DECIMAL_CHUNK_DIGITS 9
+
+/**
+ * To jest struktura przechowująca dużą liczbę.
+ */
+struct BigCoeff {
+    size_t length; ///< liczba cyfr, najstarsza jest niezerowa
+    size_t capacity; ///< na ile cyfr zaalokowana jest pamięć
+    bool negative; ///< czy liczba jest ujemna
+    uint32_t limbs[]; ///< cyfry, od najmniej znaczącej
+};
+
+/**
+ * To jest struktura opisująca wartość bezwzględną dowolnego współczynnika
+ * jako ciąg cyfr. Cyfry małego współczynnika przechowywane są w polu
+ * small, więc struktury nie wolno kopiować.
+ */
+typedef struct Magnitude {
+    const uint32_t *limbs; ///< cyfry, od najmniej znaczącej
+    size_t length; ///< liczba cyfr, najstarsza jest niezerowa
+    bool negative; ///< czy liczba jest ujemna
+    uint32_t small[SMALL_LIMBS]; ///< cyfry małego współczynnika
+} Magnitude;
+
+/**
+ * Wypełnia opis wartości bezwzględnej współczynnika.
+ * @param[in] c : współczynnik
+ * @param[out] m : opis
+ */
+static void ToMagnitude(const poly_coeff_t *c, Magnitude *m) {
+    if (c->big != NULL) {
+        m->limbs = c->big->limbs;
+        m->length = c->big->length;
+        m->negative = c->big->negative;
+        return;
+    }
+    unsigned long value = c->small < 0 ? 0 - (unsigned long) c->small :
+                          (unsigned long) c->small;
+    m->small[0] = (uint32_t) value;
+    m->small[1] = (uint32_t) (value >> LIMB_BITS);
+    m->length = m->small[1] != 0 ? 2 : m->small[0] != 0 ? 1 : 0;
+    m->limbs = m->small;
+    m->negative = c->small < 0;
+}
+
+/**
+ * Alokuje dużą liczbę.
+ * @param[in] capacity : na ile cyfr alokujemy pamięć
+ * @param[in] negative : czy liczba jest ujemna
+ * @return duża liczba o nieokreślonych cyfrach
+ */
+static BigCoeff *NewBig(size_t capacity, bool negative) {
+    BigCoeff *big = SafeBytesMalloc(sizeof(BigCoeff) +
+                                    capacity * sizeof(uint32_t));
+    big->length = capacity;
+    big->capacity = capacity;
+    big->negative = negative;
+    return big;
+}
+
+void BigCoeffFree(BigCoeff *big) {
+    BytesFree(big, sizeof(BigCoeff) + big->capacity * sizeof(uint32_t));
+}
+
+/**
+ * Normalizuje wynik działania: usuwa zera wiodące i zamienia liczbę
+ * na mały współczynnik, jeśli mieści się w typie long.
+ * @param[in] big : duża liczba, przejmowana na własność
+ * @return współczynnik
+ */
+static poly_coeff_t Normalize(BigCoeff *big) {
+    while (big->length > 0 && big->limbs[big->length - 1] == 0) {
+        big->length--;
+    }
+    if (big->length > SMALL_LIMBS)
+        return (poly_coeff_t) {.small = 0, .big = big};
+
+    unsigned long value = 0;
+    for (size_t k = big->length; k > 0; k--) {
+        value = value << LIMB_BITS | big->limbs[k - 1];
+    }
+    bool negative = big->negative;
+    if (value <= LONG_MAX) {
+        BigCoeffFree(big);
+        long small = (long) value;
+        return CoeffFromWord(negative ? -small : small);
+    }
+    if (negative && value == (unsigned long) LONG_MAX + 1) {
+        BigCoeffFree(big);
+        return CoeffFromWord(LONG_MIN);
+    }
+    return (poly_coeff_t) {.small = 0, .big = big};
+}
+
+poly_coeff_t BigCoeffFromLimbs(bool negative, const uint32_t limbs[],
+                               size_t length) {
+    BigCoeff *big = NewBig(length, negative);
+    if (length > 0)
+        memcpy(big->limbs, limbs, length * sizeof(uint32_t));
+    return Normalize(big);
+}
+
+size_t BigCoeffLimbs(const BigCoeff *big, bool *negative,
+                     const uint32_t **limbs) {
+    *negative = big->negative;
+    *limbs = big->limbs;
+    return big->length;
+}
+
+poly_coeff_t BigCoeffClone(const BigCoeff *big) {
+    return BigCoeffFromLimbs(big->negative, big->limbs, big->length);
+}
+
+/**
+ * Porównuje wartości bezwzględne.
+ * @param[in] a : wartość bezwzględna
+ * @param[in] b : wartość bezwzględna
+ * @return liczba ujemna, zero lub dodatnia, gdy @f$|a|@f$ jest mniejsza,
+ * równa lub większa od @f$|b|@f$
+ */
+static int CompareMagnitudes(const Magnitude *a, const Magnitude *b) {
+    if (a->length != b->length)
+        return a->length < b->length ? -1 : 1;
+    for (size_t k = a->length; k > 0; k--) {
+        if (a->limbs[k - 1] != b->limbs[k - 1])
+            return a->limbs[k - 1] < b->limbs[k - 1] ? -1 : 1;
+    }
+    return 0;
+}
+
+poly_coeff_t BigCoeffAdd(poly_coeff_t a, poly_coeff_t b) {
+    Magnitude x, y;
+    ToMagnitude(&a, &x);
+    ToMagnitude(&b, &y);
+    const Magnitude *larger = &x, *smaller = &y;
+    if (CompareMagnitudes(&x, &y) < 0) {
+        larger = &y;
+        smaller = &x;
+    }
+
+    // wynik ma znak składnika o większej wartości bezwzględnej
+    BigCoeff *sum = NewBig(larger->length + 1, larger->negative);
+    if (larger->negative == smaller->negative) {
+        uint64_t carry = 0;
+        for (size_t k = 0; k < larger->length; k++) {
+            carry += larger->limbs[k];
+            if (k < smaller->length)
+                carry += smaller->limbs[k];
+            sum->limbs[k] = (uint32_t) carry;
+            carry >>= LIMB_BITS;
+        }
+        sum->limbs[larger->length] = (uint32_t) carry;
+    } else {
+        uint64_t borrow = 0;
+        for (size_t k = 0; k < larger->length; k++) {
+            uint64_t subtrahend = borrow;
+            if (k < smaller->length)
+                subtrahend += smaller->limbs[k];
+            sum->limbs[k] = (uint32_t) (larger->limbs[k] - subtrahend);
+            borrow = larger->limbs[k] < subtrahend;
+        }
+        sum->limbs[larger->length] = 0;
+    }
+    return Normalize(sum);
+}
+
+poly_coeff_t BigCoeffMul(poly_coeff_t a, poly_coeff_t b) {
+    Magnitude x, y;
+    ToMagnitude(&a, &x);
+    ToMagnitude(&b, &y);
+    if (x.length == 0 || y.length == 0)
+        return CoeffFromWord(0);
+
+    BigCoeff *product = NewBig(x.length + y.length, x.negative != y.negative);
+    memset(product->limbs, 0, product->length * sizeof(uint32_t));
+    for (size_t i = 0; i < x.length; i++) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < y.length; j++) {
+            carry += (uint64_t) x.limbs[i] * y.limbs[j] +
+                     product->limbs[i + j];
+            product->limbs[i + j] = (uint32_t) carry;
+            carry >>= LIMB_BITS;
+        }
+        product->limbs[i + y.length] = (uint32_t) carry;
+    }
+    return Normalize(product);
+}
+
+poly_coeff_t BigCoeffNeg(poly_coeff_t a) {
+    Magnitude x;
+    ToMagnitude(&a, &x);
+    return BigCoeffFromLimbs(!x.negative, x.limbs, x.length);
+}
+
+bool BigCoeffEq(const BigCoeff *a, const BigCoeff *b) {
+    return a->negative == b->negative && a->length == b->length &&
+           memcmp(a->limbs, b->limbs, a->length * sizeof(uint32_t)) == 0;
+}
+
+poly_coeff_t BigCoeffFromDigits(const char digits[], size_t count,
+                                bool negative) {
+    // każda cyfra dziesiętna to mniej niż 4 bity
+    BigCoeff *big = NewBig(count / 8 + 1, negative);
+    big->length = 0;
+    for (size_t i = 0; i < count; i += DECIMAL_CHUNK_DIGITS) {
+        uint32_t chunk = 0, scale = 1;
+        for (size_t j = i; j < count && j < i + DECIMAL_CHUNK_DIGITS; j++) {
+            chunk = chunk * 10 + (uint32_t) (digits[j] - '0');
+            scale *= 10;
+        }
+        // big = big * scale + chunk
+        uint64_t carry = chunk;
+        for (size_t k = 0; k < big->length; k++) {
+            carry += (uint64_t) big->limbs[k] * scale;
+            big->limbs[k] = (uint32_t) carry;
+            carry >>= LIMB_BITS;
+        }
+        if (carry != 0)
+            big->limbs[big->length++] = (uint32_t) carry;
+    }
+    return Normalize(big);
+}
+
+/**
+ * Zwraca rozmiar bufora na zapis dziesiętny dużej liczby.
+ * @param[in] big : duża liczba
+ * @return rozmiar bufora
+ */
+static size_t DecimalCapacity(const BigCoeff *big) {
+    // cyfra o podstawie 2^32 to mniej niż 10 cyfr dziesiętnych
+    return big->length * 10 + 1;
+}
+
+/**
+ * Zamienia dużą liczbę na zapis dziesiętny.
+ * @param[in] big : duża liczba
+ * @param[out] length : długość zapisu
+ * @return zapis, do zwolnienia funkcją BytesFree z rozmiarem
+ * DecimalCapacity(big)
+ */
+static char *ToDecimal(const BigCoeff *big, size_t *length) {
+    size_t capacity = DecimalCapacity(big);
+    char *text = SafeBytesMalloc(capacity);
+    uint32_t *rest = SafeBytesMalloc(big->length * sizeof(uint32_t));
+    memcpy(rest, big->limbs, big->length * sizeof(uint32_t));
+
+    // cyfry wpisujemy od końca bufora, dzieląc przez 10^9
+    size_t begin = capacity, rest_length = big->length;
+    while (rest_length > 0) {
+        uint64_t remainder = 0;
+        for (size_t k = rest_length; k > 0; k--) {
+            remainder = remainder << LIMB_BITS | rest[k - 1];
+            rest[k - 1] = (uint32_t) (remainder / DECIMAL_CHUNK);
+            remainder %= DECIMAL_CHUNK;
+        }
+        while (rest_length > 0 && rest[rest_length - 1] == 0) {
+            rest_length--;
+        }
+        for (int j = 0; j < DECIMAL_CHUNK_DIGITS &&
+                        (rest_length > 0 || remainder > 0); j++) {
+            text[--begin] = (char) ('0' + remainder % 10);
+            remainder /= 10;
+        }
+    }
+    if (big->negative)
+        text[--begin] = '-';
+    BytesFree(rest, big->length * sizeof(uint32_t));
+
+    *length = capacity - begin;
+    memmove(text, text + begin, *length);
+    return text;
+}
+
+void BigCoeffAppend(StringWithSize *out, const BigCoeff *big) {
+    size_t length;
+    char *text = ToDecimal(big, &length);
+    StringAppend(out, text, length);
+    BytesFree(text, DecimalCapacity(big));
+}
+
+void BigCoeffPrint(const BigCoeff *big) {
+    size_t length;
+    char *text = ToDecimal(big, &length);
+    PrintBytes(text, length);
+    BytesFree(text, DecimalCapacity(big));
+}
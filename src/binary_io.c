@@ -0,0 +1,277 @@
+/** @file
+  Implementacja binarnego formatu wielomianów.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <stdint.h>
+#include "binary_io.h"
+#include "mallocs.h"
+
+/**
+ * Koduje liczbę ze znakiem tak, żeby liczby o małej wartości
+ * bezwzględnej miały krótki zapis varint (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...).
+ * @param[in] x : liczba
+ * @return zakodowana liczba
+ */
+static unsigned long long ZigZag(long long x) {
+    return (unsigned long long) x << 1 ^ (x < 0 ? ~0ULL : 0ULL);
+}
+
+/**
+ * Odwraca kodowanie ZigZag.
+ * @param[in] x : zakodowana liczba
+ * @return liczba
+ */
+static long long UnZigZag(unsigned long long x) {
+    return (long long) (x >> 1) ^ -(long long) (x & 1);
+}
+
+/**
+ * Odczytuje liczbę w kodowaniu varint zaczynającą się na pozycji @p *i.
+ * @param[in] str : rekord
+ * @param[in,out] i : aktualny indeks, po wyjściu - pierwszy bajt za liczbą
+ * @param[in] end : indeks końca rekordu (wyłącznie)
+ * @param[out] value : odczytana liczba
+ * @return czy odczytano poprawną liczbę
+ */
+static bool DecodeNumber(StringWithSize str, size_t *i, size_t end,
+                         unsigned long long *value) {
+    size_t length = DecodeVarint(str.A + *i, end - *i, value);
+    *i += length;
+    return length > 0;
+}
+
+/**
+ * Odczytuje współczynnik zaczynający się na pozycji @p *i.
+ * @param[in] str : rekord
+ * @param[in,out] i : aktualny indeks, po wyjściu - pierwszy bajt za liczbą
+ * @param[in] end : indeks końca rekordu (wyłącznie)
+ * @param[out] coeff : odczytany współczynnik
+ * @return czy odczytano poprawny współczynnik
+ */
+static bool DecodeCoeff(StringWithSize str, size_t *i, size_t end,
+                        poly_coeff_t *coeff) {
+#ifdef POLY_COEFF_INT128
+    unsigned long long low, high;
+    if (!DecodeNumber(str, i, end, &low) || !DecodeNumber(str, i, end, &high))
+        return false;
+    poly_ucoeff_t zigzag = (poly_ucoeff_t) high << 64 | low;
+    *coeff = (poly_coeff_t) (zigzag >> 1) ^ -(poly_coeff_t) (zigzag & 1);
+#elif defined(POLY_COEFF_BIG)
+    unsigned long long header;
+    if (!DecodeNumber(str, i, end, &header))
+        return false;
+    if (header == 0) {
+        unsigned long long zigzag;
+        if (!DecodeNumber(str, i, end, &zigzag))
+            return false;
+        *coeff = CoeffFromWord((poly_coeff_word_t) UnZigZag(zigzag));
+        return true;
+    }
+    // każda cyfra zajmuje co najmniej jeden bajt
+    unsigned long long length = header >> 1;
+    if (length > end - *i)
+        return false;
+    uint32_t *limbs = SafeBytesMalloc(length * sizeof(uint32_t));
+    for (size_t k = 0; k < length; k++) {
+        unsigned long long limb;
+        if (!DecodeNumber(str, i, end, &limb) || limb > UINT32_MAX) {
+            BytesFree(limbs, length * sizeof(uint32_t));
+            return false;
+        }
+        limbs[k] = (uint32_t) limb;
+    }
+    *coeff = BigCoeffFromLimbs(header & 1, limbs, length);
+    BytesFree(limbs, length * sizeof(uint32_t));
+#else
+    unsigned long long zigzag;
+    if (!DecodeNumber(str, i, end, &zigzag))
+        return false;
+    *coeff = CoeffReduce((poly_coeff_t) UnZigZag(zigzag));
+#endif
+    return true;
+}
+
+/**
+ * Dopisuje zapis współczynnika do napisu.
+ * @param[in] coeff : współczynnik
+ * @param[in,out] out : napis
+ */
+static void EncodeCoeff(poly_coeff_t coeff, StringWithSize *out) {
+#ifdef POLY_COEFF_INT128
+    poly_ucoeff_t zigzag = (poly_ucoeff_t) coeff << 1 ^
+                           (coeff < 0 ? ~(poly_ucoeff_t) 0 : 0);
+    StringAppendVarint(out, (unsigned long long) zigzag);
+    StringAppendVarint(out, (unsigned long long) (zigzag >> 64));
+#elif defined(POLY_COEFF_BIG)
+    if (coeff.big == NULL) {
+        StringAppendVarint(out, 0);
+        StringAppendVarint(out, ZigZag(coeff.small));
+        return;
+    }
+    bool negative;
+    const uint32_t *limbs;
+    size_t length = BigCoeffLimbs(coeff.big, &negative, &limbs);
+    StringAppendVarint(out, (unsigned long long) length << 1 | negative);
+    for (size_t k = 0; k < length; k++) {
+        StringAppendVarint(out, limbs[k]);
+    }
+#else
+    StringAppendVarint(out, ZigZag(coeff));
+#endif
+}
+
+/**
+ * Usuwa jednomiany z tablicy i zwalnia jej pamięć.
+ * @param[in] count : liczba jednomianów
+ * @param[in] capacity : na ile jednomianów zaalokowana jest tablica
+ * @param[in] monos : tablica jednomianów
+ */
+static void DestroyMonos(size_t count, size_t capacity, Mono monos[]) {
+    for (size_t j = 0; j < count; j++) {
+        MonoDestroy(&monos[j]);
+    }
+    MonoArrayFree(monos, capacity);
+}
+
+/**
+ * Odczytuje zapis wielomianu zaczynający się na pozycji @p *i.
+ * @param[in] str : rekord
+ * @param[in,out] i : aktualny indeks, po wyjściu - pierwszy bajt za zapisem
+ * @param[in] end : indeks końca rekordu (wyłącznie)
+ * @param[out] result : odczytany wielomian
+ * @param[out] in_range : czy wykładniki mieszczą się w zakresie
+ * @return czy odczytano poprawny wielomian
+ */
+static bool DecodePoly(StringWithSize str, size_t *i, size_t end,
+                       Poly *result, bool *in_range) {
+    unsigned long long count;
+    if (!DecodeNumber(str, i, end, &count))
+        return false;
+    if (count == 0) {
+        poly_coeff_t coeff;
+        if (!DecodeCoeff(str, i, end, &coeff))
+            return false;
+        *result = PolyFromCoeff(coeff);
+        return true;
+    }
+    // każdy jednomian zajmuje co najmniej dwa bajty, więc nie alokujemy
+    // więcej pamięci, niż pozwala na to długość rekordu
+    if (count > (end - *i) / 2)
+        return false;
+
+    Mono *monos;
+    SafeMonoMalloc(&monos, (size_t) count);
+    size_t kept = 0;
+    long long exp = 0;
+    for (unsigned long long k = 0; k < count; k++) {
+        unsigned long long delta;
+        Poly p;
+        if (!DecodeNumber(str, i, end, &delta)) {
+            DestroyMonos(kept, (size_t) count, monos);
+            return false;
+        }
+        long long step = UnZigZag(delta);
+        if (step > INT_MAX || step < -(long long) INT_MAX ||
+            exp + step < 0 || exp + step > INT_MAX) {
+            *in_range = false;
+            DestroyMonos(kept, (size_t) count, monos);
+            return false;
+        }
+        exp += step;
+        if (!DecodePoly(str, i, end, &p, in_range)) {
+            DestroyMonos(kept, (size_t) count, monos);
+            return false;
+        }
+        if (PolyIsZero(&p))
+            continue; // zerowy jednomian nie wnosi nic do sumy
+        monos[kept++] = MonoFromPoly(&p, (poly_exp_t) exp);
+    }
+
+    if (kept == 0) {
+        MonoArrayFree(monos, (size_t) count);
+        *result = PolyZero();
+        return true;
+    }
+    if (kept < count) {
+        // wielomian przechowuje tablicę dokładnie na swoje jednomiany
+        SafeMonoRealloc(&monos, (size_t) count, kept);
+    }
+    *result = PolyOwnMonos(kept, monos);
+    return true;
+}
+
+Poly PolyFromBinary(StringWithSize str, bool *correct, bool *in_range) {
+    Poly result = PolyZero();
+    unsigned long long length;
+    size_t i = 1;
+    *in_range = true;
+    *correct = DecodeNumber(str, &i, str.length, &length) &&
+               length == str.length - i &&
+               DecodePoly(str, &i, str.length, &result, in_range) &&
+               i == str.length;
+
+    if (!*correct || !*in_range) {
+        PolyDestroy(&result);
+    }
+    return result;
+}
+
+/**
+ * Dopisuje zapis wielomianu do napisu.
+ * @param[in] p : wielomian
+ * @param[in,out] out : napis
+ */
+static void EncodePoly(const Poly *p, StringWithSize *out) {
+    if (PolyIsCoeff(p)) {
+        StringAppendVarint(out, 0);
+        EncodeCoeff(p->coeff, out);
+        return;
+    }
+    StringAppendVarint(out, p->size);
+    poly_exp_t previous = 0;
+    for (size_t i = 0; i < p->size; i++) {
+        poly_exp_t exp = MonoGetExp(&p->arr[i]);
+        StringAppendVarint(out, ZigZag((long long) exp - previous));
+        EncodePoly(&p->arr[i].p, out);
+        previous = exp;
+    }
+}
+
+/**
+ * Zapisuje nagłówek rekordu: znacznik i długość treści.
+ * @param[in] payload : treść rekordu
+ * @param[out] header : bufor na co najmniej 1 + VARINT_MAX_LENGTH bajtów
+ * @return długość nagłówka
+ */
+static size_t EncodeHeader(const StringWithSize *payload, char header[]) {
+    header[0] = BINARY_RECORD_MARKER;
+    return 1 + EncodeVarint(payload->length, header + 1);
+}
+
+StringWithSize PolyToBinary(const Poly *p) {
+    StringWithSize payload = StringInit();
+    EncodePoly(p, &payload);
+
+    char header[1 + VARINT_MAX_LENGTH];
+    StringWithSize record = StringInit();
+    StringAppend(&record, header, EncodeHeader(&payload, header));
+    StringAppend(&record, payload.A, payload.length);
+    StringFree(&payload);
+    return record;
+}
+
+void PolyPrintBinary(const Poly *p) {
+    StringWithSize payload = StringInit();
+    EncodePoly(p, &payload);
+
+    char header[1 + VARINT_MAX_LENGTH];
+    PrintBytes(header, EncodeHeader(&payload, header));
+    PrintBytes(payload.A, payload.length);
+    StringFree(&payload);
+}
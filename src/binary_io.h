@@ -0,0 +1,66 @@
+/** @file
+  Binarny format wielomianów (tryb --binary-io), pozwalający łączyć
+  kalkulatory w potoki bez formatowania i parsowania zapisu tekstowego.
+
+  Rekord to bajt BINARY_RECORD_MARKER, długość treści w kodowaniu varint
+  i treść, czyli zapis wielomianu:
+  - współczynnik: liczba 0 i współczynnik w kodowaniu zigzag,
+  - wielomian o n > 0 jednomianach: liczba n, a po niej dla każdego
+    jednomianu różnica wykładnika i wykładnika poprzedniego jednomianu
+    (dla pierwszego - wykładnik) w kodowaniu zigzag i zapis jego
+    współczynnika.
+
+  Wszystkie liczby zapisane są w kodowaniu varint. W wariancie
+  POLY_COEFF_INT128 (zob. coeff.h) współczynnik zapisany jest jako dwie
+  liczby: młodsze i starsze 64 bity kodowania zigzag. W wariancie
+  POLY_COEFF_BIG współczynnik poprzedza nagłówek: 0, jeśli dalej jest
+  mały współczynnik w kodowaniu zigzag, albo @f$2n + s@f$ dla dużej
+  liczby o n cyfrach w systemie o podstawie @f$2^{32}@f$ i znaku s
+  (1 dla liczby ujemnej), zapisanych dalej od najmniej znaczącej.
+  Rekordy wariantów o różnych typach współczynników nie są więc wymienne.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <stdbool.h>
+#include "poly.h"
+#include "input_output.h"
+
+/**
+ * Czy wiersz jest binarnym rekordem wielomianu?
+ * @param[in] str : niepusty wiersz
+ * @return czy wiersz zaczyna się od BINARY_RECORD_MARKER
+ */
+static inline bool IsBinaryRecord(StringWithSize str) {
+    return str.A[0] == BINARY_RECORD_MARKER;
+}
+
+/**
+ * Odczytuje wielomian z binarnego rekordu. Jednomiany nie muszą być
+ * posortowane ani zsumowane, ale rekord musi być kompletny i nie może
+ * zawierać nic poza zapisem wielomianu.
+ * @param[in] str : rekord
+ * @param[out] correct : czy rekord jest poprawny
+ * @param[out] in_range : czy wykładniki mieszczą się w zakresie
+ * @return wielomian
+ */
+Poly PolyFromBinary(StringWithSize str, bool *correct, bool *in_range);
+
+/**
+ * Zapisuje wielomian jako binarny rekord.
+ * @param[in] p : wielomian
+ * @return rekord, do zwolnienia funkcją StringFree
+ */
+StringWithSize PolyToBinary(const Poly *p);
+
+/**
+ * Wypisuje wielomian jako binarny rekord.
+ * @param[in] p : wielomian
+ */
+void PolyPrintBinary(const Poly *p);
+
+#endif //BINARY_IO_H
@@ -7,28 +7,201 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "calc.h"
+#include "batch.h"
 #include "stack.h"
 #include "input_output.h"
 #include "parsing.h"
+#include "commands.h"
+#include "pipeline.h"
+#include "stats.h"
+#include "trace.h"
+#include "perf.h"
+#include "server.h"
+
+void RunCalculator(const CalcOptions *options) {
+    InputReader reader = ReaderInit();
+    PolyStack stack = StackInit(INITIAL_STACK_SIZE);
+
+    if (options->stats)
+        StatsEnable(options->stats_lines);
+    if (options->trace_file != NULL &&
+        !TraceOpen(options->trace_file, options->trace_depth))
+        perror(options->trace_file);
+    if (options->perf)
+        PerfEnable();
+    long threads = options->threads > 0 ? options->threads : ProcessorCount();
+    // liczniki sprzętowe i liczniki alokacji mierzą tylko bieżący wątek,
+    // więc przy --perf i --stats całe parsowanie, wypisywanie i wykonywanie
+    // odbywa się w nim
+    bool single_thread = perf_enabled || options->stats;
+    if (single_thread)
+        threads = 1;
+    SetParseThreads(threads);
+    SetPrintThreads(threads);
+    binary_input = options->binary_input;
+    binary_output = options->binary_output;
+    reader.binary = options->binary_input;
+    if (options->pipeline && !single_thread) {
+        RunPipelined(&reader, &stack);
+    } else {
+        ExecuteLines(&reader, &stack);
+    }
+
+    ReaderClear(&reader);
+    StackClear(&stack);
+    TraceClose();
+
+    if (options->stats) {
+        // tabela nie może wyprzedzić wyników i błędów
+        FlushOutput();
+        FILE *out = stderr;
+        if (options->stats_file != NULL)
+            out = fopen(options->stats_file, "w");
+        if (out == NULL) {
+            perror(options->stats_file);
+            out = stderr;
+        }
+        StatsReport(out);
+        if (out != stderr)
+            fclose(out);
+    }
+    if (perf_enabled) {
+        FlushOutput();
+        PerfReport(stderr);
+    }
+}
+
+/**
+ * Wypisuje sposób użycia programu.
+ * @param[in] program : nazwa programu
+ * @return 1 - kod wyjścia programu
+ */
+static int Usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [--pipeline] [--stats[=FILE]] [--stats-lines]\n"
+            "          [--trace FILE] [--trace-depth N] [--perf]\n"
+            "          [--threads N] [--binary-io[=in|out]]\n"
+            "          [-j JOBS] [FILE|DIR]...\n"
+            "       %s --server PATH [--session-memory BYTES]\n"
+            "          [--binary-io[=in|out]] [-j JOBS]\n",
+            program, program);
+    return 1;
+}
 
 /**
  * Funkcja main kalkulatora.
+ * Bez argumentów wykonuje skrypt ze standardowego wejścia.
+ * Opcja --pipeline włącza parsowanie wielomianów w osobnym wątku.
+ * Opcja --stats wypisuje na końcu statystyki poleceń na stderr
+ * (lub do podanego pliku), a --stats-lines dodaje statystyki każdego wiersza.
+ * Opcja --trace zapisuje przebieg wykonania w formacie Chrome Trace Event,
+ * a --trace-depth ogranicza głębokość zapisywanych przedziałów.
+ * Opcja --perf wypisuje na końcu sprzętowe liczniki wydajności poleceń;
+ * liczniki mierzą jeden wątek, więc --perf wyłącza --pipeline i --threads.
+ * Z tego samego powodu wyłącza je także --stats.
+ * Opcja --threads ustala, iloma wątkami parsowany i wypisywany jest jeden
+ * długi wielomian (domyślnie liczba procesorów).
+ * Opcja --binary-io włącza binarny format wielomianów na wejściu
+ * i w wyniku PRINT (zob. binary_io.h), a --binary-io=in i --binary-io=out
+ * odpowiednio tylko na wejściu lub tylko w wyniku, np. dla pierwszego
+ * i ostatniego kalkulatora w potoku.
+ * Podane pliki i katalogi są wykonywane jako niezależne skrypty
+ * przez co najwyżej JOBS procesów naraz (domyślnie liczba procesorów).
+ * Opcja --server uruchamia serwer przyjmujący sesje kalkulatora przez
+ * gniazdo domeny uniksowej PATH (zob. server.h), obsługiwane przez JOBS
+ * wątków, z limitem pamięci sesji --session-memory.
+ * @param[in] argc : liczba argumentów
+ * @param[in] argv : argumenty
  * @return 0, jeśli program zakończył się poprawnie, 1 w.p.p.
  */
-int main() {
-    StringWithSize str = StringInit();
-    PolyStack stack = StackInit(INITIAL_STACK_SIZE);
-    char c;
-    int line = 1;
-    bool was_eof = false;
-
-    while (!was_eof && (c = (char) getchar()) != EOF) {
-        ReadLine(&str, c, &was_eof);
-        AnalyzeLine(str, line, &stack);
-        line++;
+int main(int argc, char *argv[]) {
+    CalcOptions options = {.pipeline = false, .stats = false,
+                           .stats_lines = false, .stats_file = NULL,
+                           .trace_file = NULL,
+                           .trace_depth = TRACE_DEFAULT_DEPTH,
+                           .perf = false, .binary_input = false,
+                           .binary_output = false, .threads = 0};
+    long jobs = 0;
+    int first_path = argc;
+    const char *server_path = NULL;
+    long long session_memory = SERVER_SESSION_MEMORY;
+
+    for (int i = 1; i < argc && first_path == argc; i++) {
+        if (strcmp(argv[i], "--pipeline") == 0) {
+            options.pipeline = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            options.stats = true;
+        } else if (strncmp(argv[i], "--stats=", 8) == 0 && argv[i][8]) {
+            options.stats = true;
+            options.stats_file = argv[i] + 8;
+        } else if (strcmp(argv[i], "--stats-lines") == 0) {
+            options.stats = true;
+            options.stats_lines = true;
+        } else if (strcmp(argv[i], "--binary-io") == 0) {
+            options.binary_input = true;
+            options.binary_output = true;
+        } else if (strcmp(argv[i], "--binary-io=in") == 0) {
+            options.binary_input = true;
+        } else if (strcmp(argv[i], "--binary-io=out") == 0) {
+            options.binary_output = true;
+        } else if (strcmp(argv[i], "--perf") == 0) {
+            options.perf = true;
+        } else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+            options.trace_file = argv[++i];
+        } else if (strcmp(argv[i], "--trace-depth") == 0 && i + 1 < argc) {
+            char *end;
+            long depth = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || depth < 0 || depth > 1000)
+                return Usage(argv[0]);
+            options.trace_depth = (int) depth;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            char *end;
+            options.threads = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || options.threads <= 0 ||
+                options.threads > PARSE_MAX_THREADS)
+                return Usage(argv[0]);
+        } else if (strcmp(argv[i], "--server") == 0 && i + 1 < argc) {
+            server_path = argv[++i];
+        } else if (strcmp(argv[i], "--session-memory") == 0 &&
+                   i + 1 < argc) {
+            char *end;
+            session_memory = strtoll(argv[++i], &end, 10);
+            if (*end != '\0' || session_memory < SERVER_MIN_SESSION_MEMORY)
+                return Usage(argv[0]);
+        } else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            char *end;
+            jobs = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || jobs <= 0)
+                return Usage(argv[0]);
+        } else if (argv[i][0] == '-') {
+            return Usage(argv[0]);
+        } else {
+            first_path = i;
+        }
     }
 
-    free(str.A);
-    StackClear(&stack);
+    if (server_path != NULL) {
+        // sesje nie mogą dzielić statystyk, zapisu przebiegu ani wejścia
+        if (first_path < argc || options.pipeline || options.stats ||
+            options.trace_file != NULL || options.perf)
+            return Usage(argv[0]);
+        if (jobs == 0)
+            jobs = ProcessorCount();
+        return RunServer(server_path, jobs, session_memory, &options);
+    }
+
+    if (first_path < argc) {
+        // procesy robocze nadpisywałyby sobie nawzajem pliki wyników
+        if (options.stats_file != NULL || options.trace_file != NULL)
+            return Usage(argv[0]);
+        if (jobs == 0)
+            jobs = ProcessorCount();
+        return RunBatch(argv + first_path, argc - first_path, jobs, &options);
+    }
+
+    RunCalculator(&options);
     return 0;
 }
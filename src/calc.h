@@ -0,0 +1,38 @@
+/** @file
+  Opcje i uruchamianie kalkulatora.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#ifndef CALC_H
+#define CALC_H
+
+#include <stdbool.h>
+
+/**
+ * To jest struktura przechowująca opcje wykonywania skryptu kalkulatora.
+ */
+typedef struct CalcOptions {
+    bool pipeline; ///< czy parsować wielomiany w osobnym wątku
+    bool stats; ///< czy zbierać statystyki wykonywania poleceń
+    bool stats_lines; ///< czy zbierać statystyki każdego wiersza
+    const char *stats_file; ///< plik na statystyki, NULL dla stderr
+    const char *trace_file; ///< plik na zapis przebiegu, NULL - bez zapisu
+    int trace_depth; ///< maksymalna głębokość zapisywanych przedziałów
+    bool perf; ///< czy mierzyć sprzętowe liczniki wydajności poleceń
+    bool binary_input; ///< czy rozpoznawać na wejściu binarne rekordy wielomianów
+    bool binary_output; ///< czy PRINT wypisuje wielomiany jako binarne rekordy
+    long threads; ///< liczba wątków parsujących i wypisujących długi wielomian, 0 - liczba procesorów
+} CalcOptions;
+
+/**
+ * Wykonuje skrypt kalkulatora ze standardowego wejścia.
+ * W trybie statystyk na końcu wypisuje tabelę statystyk.
+ * Jeśli podano plik zapisu przebiegu, zapisuje w nim przebieg wykonania.
+ * W trybie liczników sprzętowych na końcu wypisuje ich tabelę na stderr.
+ * @param[in] options : opcje wykonywania
+ */
+void RunCalculator(const CalcOptions *options);
+
+#endif //CALC_H
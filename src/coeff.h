@@ -0,0 +1,554 @@
+/** @file
+  Typ i arytmetyka współczynników wielomianów, wybierane przy kompilacji.
+
+  Domyślnie współczynniki są typu long, a działania wykonywane są
+  modulo @f$2^{64}@f$. Makro POLY_COEFF_INT128 wybiera typ __int128
+  (działania modulo @f$2^{128}@f$), a makro POLY_COEFF_MOD - resztę
+  z dzielenia przez liczbę pierwszą POLY_COEFF_MODULUS, przechowywaną
+  w typie long jako liczba z przedziału [0, POLY_COEFF_MODULUS).
+  Makro POLY_COEFF_BIG wybiera dokładne liczby całkowite dowolnej
+  wielkości: działania na współczynnikach mieszczących się w typie long
+  sprawdzają przepełnienie i tylko wtedy przechodzą do wolnej ścieżki
+  z bigcoeff.c, która przechowuje wynik w osobno zaalokowanej pamięci.
+  Wszystkie funkcje są rozwijane w miejscu użycia, więc wybór wariantu
+  nie kosztuje nic w czasie działania.
+
+  Współczynnik jest właścicielem swojej pamięci tylko w wariancie
+  POLY_COEFF_BIG, ale kod wielomianów zawsze stosuje CoeffClone
+  i CoeffDestroy tak, jakby był - w pozostałych wariantach te funkcje
+  nic nie robią.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#ifndef COEFF_H
+#define COEFF_H
+
+#include <limits.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "input_output.h"
+
+#if defined(POLY_COEFF_INT128) + defined(POLY_COEFF_MOD) + \
+    defined(POLY_COEFF_BIG) > 1
+#error "POLY_COEFF_INT128, POLY_COEFF_MOD and POLY_COEFF_BIG are mutually exclusive"
+#endif
+
+#ifdef POLY_COEFF_INT128
+
+/** To jest typ reprezentujący współczynniki. */
+__extension__ typedef __int128 poly_coeff_t;
+
+/** To jest typ, w którym akumulujemy zapis dziesiętny współczynnika. */
+typedef poly_coeff_t poly_coeff_word_t;
+
+/** To jest typ bez znaku, na którym liczymy działania modulo. */
+__extension__ typedef unsigned __int128 poly_ucoeff_t;
+
+/** Najmniejsza wartość współczynnika w zapisie dziesiętnym. */
+#define POLY_COEFF_MIN ((poly_coeff_t) ((poly_ucoeff_t) 1 << 127))
+
+/** Maksymalna liczba znaków zapisu dziesiętnego współczynnika. */
+#define POLY_COEFF_DIGITS 40
+
+#elif defined(POLY_COEFF_BIG)
+
+/** Liczba całkowita, która nie mieści się w typie long (zob. bigcoeff.c). */
+typedef struct BigCoeff BigCoeff;
+
+/**
+ * To jest typ reprezentujący współczynniki: liczba typu long albo,
+ * jeśli się w nim nie mieści, wskaźnik na dużą liczbę.
+ */
+typedef struct poly_coeff_t {
+    long small; ///< wartość, jeśli big == NULL
+    BigCoeff *big; ///< duża liczba lub NULL
+} poly_coeff_t;
+
+/** To jest typ, w którym mieszczą się małe współczynniki. */
+typedef long poly_coeff_word_t;
+
+/** To jest typ bez znaku odpowiadający poly_coeff_word_t. */
+typedef unsigned long poly_ucoeff_t;
+
+/** Najmniejsza wartość małego współczynnika. */
+#define POLY_COEFF_MIN LONG_MIN
+
+/** Maksymalna liczba znaków zapisu dziesiętnego małego współczynnika. */
+#define POLY_COEFF_DIGITS 20
+
+#else
+
+/** To jest typ reprezentujący współczynniki. */
+typedef long poly_coeff_t;
+
+/** To jest typ, w którym akumulujemy zapis dziesiętny współczynnika. */
+typedef poly_coeff_t poly_coeff_word_t;
+
+/** To jest typ bez znaku, na którym liczymy działania modulo. */
+typedef unsigned long poly_ucoeff_t;
+
+/** Najmniejsza wartość współczynnika w zapisie dziesiętnym. */
+#define POLY_COEFF_MIN LONG_MIN
+
+/** Maksymalna liczba znaków zapisu dziesiętnego współczynnika. */
+#define POLY_COEFF_DIGITS 20
+
+#endif
+
+#ifdef POLY_COEFF_MOD
+
+#ifndef POLY_COEFF_MODULUS
+/**
+ * Moduł współczynników: liczba pierwsza mniejsza od @f$2^{62}@f$, podana
+ * jako stała całkowita. Domyślnie liczba pierwsza Mersenne'a
+ * @f$2^{61} - 1@f$, dla której mnożenie nie wymaga dzielenia.
+ */
+#define POLY_COEFF_MODULUS ((1L << 61) - 1)
+#endif
+
+#if POLY_COEFF_MODULUS < 2 || POLY_COEFF_MODULUS >= (1L << 62)
+#error "POLY_COEFF_MODULUS must be in [2, 2^62)"
+#endif
+
+/**
+ * Sprowadza liczbę do reszty z przedziału [0, POLY_COEFF_MODULUS).
+ * @param[in] x : liczba
+ * @return reszta
+ */
+static inline poly_coeff_t CoeffReduce(poly_coeff_t x) {
+    x %= POLY_COEFF_MODULUS;
+    return x < 0 ? x + POLY_COEFF_MODULUS : x;
+}
+
+/**
+ * Dodaje współczynniki.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @return @f$a + b@f$
+ */
+static inline poly_coeff_t CoeffAdd(poly_coeff_t a, poly_coeff_t b) {
+    poly_coeff_t sum = a + b; // obie reszty są mniejsze od 2^62
+    return sum >= POLY_COEFF_MODULUS ? sum - POLY_COEFF_MODULUS : sum;
+}
+
+/**
+ * Mnoży współczynniki.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @return @f$a \cdot b@f$
+ */
+static inline poly_coeff_t CoeffMul(poly_coeff_t a, poly_coeff_t b) {
+    __extension__ unsigned __int128 product =
+        (unsigned __int128) a * (unsigned __int128) b;
+#if POLY_COEFF_MODULUS == (1L << 61) - 1
+    // 2^61 przystaje do 1, więc starsze bity dodajemy do młodszych
+    unsigned long folded = (unsigned long) (product & POLY_COEFF_MODULUS) +
+                           (unsigned long) (product >> 61);
+    return (poly_coeff_t) (folded >= POLY_COEFF_MODULUS ?
+                           folded - POLY_COEFF_MODULUS : folded);
+#else
+    return (poly_coeff_t) (product % POLY_COEFF_MODULUS);
+#endif
+}
+
+/**
+ * Zwraca współczynnik przeciwny.
+ * @param[in] a : współczynnik
+ * @return @f$-a@f$
+ */
+static inline poly_coeff_t CoeffNeg(poly_coeff_t a) {
+    return a == 0 ? 0 : POLY_COEFF_MODULUS - a;
+}
+
+#elif defined(POLY_COEFF_BIG)
+
+/**
+ * Dodaje współczynniki, z których co najmniej jeden jest duży
+ * albo których suma nie mieści się w typie long.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @return @f$a + b@f$
+ */
+poly_coeff_t BigCoeffAdd(poly_coeff_t a, poly_coeff_t b);
+
+/**
+ * Mnoży współczynniki, z których co najmniej jeden jest duży
+ * albo których iloczyn nie mieści się w typie long.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @return @f$a \cdot b@f$
+ */
+poly_coeff_t BigCoeffMul(poly_coeff_t a, poly_coeff_t b);
+
+/**
+ * Zwraca współczynnik przeciwny do dużego współczynnika lub do LONG_MIN.
+ * @param[in] a : współczynnik
+ * @return @f$-a@f$
+ */
+poly_coeff_t BigCoeffNeg(poly_coeff_t a);
+
+/**
+ * Tworzy kopię dużej liczby.
+ * @param[in] big : duża liczba
+ * @return współczynnik
+ */
+poly_coeff_t BigCoeffClone(const BigCoeff *big);
+
+/**
+ * Zwalnia pamięć dużej liczby.
+ * @param[in] big : duża liczba
+ */
+void BigCoeffFree(BigCoeff *big);
+
+/**
+ * Sprawdza równość dużych liczb.
+ * @param[in] a : duża liczba
+ * @param[in] b : duża liczba
+ * @return czy @f$a = b@f$
+ */
+bool BigCoeffEq(const BigCoeff *a, const BigCoeff *b);
+
+/**
+ * Tworzy współczynnik z zapisu dziesiętnego bez znaku.
+ * @param[in] digits : cyfry
+ * @param[in] count : liczba cyfr
+ * @param[in] negative : czy liczba jest ujemna
+ * @return współczynnik
+ */
+poly_coeff_t BigCoeffFromDigits(const char digits[], size_t count,
+                                bool negative);
+
+/**
+ * Dopisuje zapis dziesiętny dużej liczby do napisu.
+ * @param[in,out] out : napis
+ * @param[in] big : duża liczba
+ */
+void BigCoeffAppend(StringWithSize *out, const BigCoeff *big);
+
+/**
+ * Wypisuje zapis dziesiętny dużej liczby.
+ * @param[in] big : duża liczba
+ */
+void BigCoeffPrint(const BigCoeff *big);
+
+/**
+ * Udostępnia cyfry dużej liczby w systemie o podstawie @f$2^{32}@f$.
+ * @param[in] big : duża liczba
+ * @param[out] negative : czy liczba jest ujemna
+ * @param[out] limbs : cyfry, od najmniej znaczącej
+ * @return liczba cyfr
+ */
+size_t BigCoeffLimbs(const BigCoeff *big, bool *negative,
+                     const uint32_t **limbs);
+
+/**
+ * Tworzy współczynnik z cyfr w systemie o podstawie @f$2^{32}@f$.
+ * @param[in] negative : czy liczba jest ujemna
+ * @param[in] limbs : cyfry, od najmniej znaczącej
+ * @param[in] length : liczba cyfr
+ * @return współczynnik
+ */
+poly_coeff_t BigCoeffFromLimbs(bool negative, const uint32_t limbs[],
+                               size_t length);
+
+/**
+ * Zamienia małą liczbę na współczynnik.
+ * @param[in] x : liczba
+ * @return współczynnik
+ */
+static inline poly_coeff_t CoeffFromWord(poly_coeff_word_t x) {
+    return (poly_coeff_t) {.small = x, .big = NULL};
+}
+
+/**
+ * Sprowadza liczbę do postaci współczynnika (tu: nic nie zmienia).
+ * @param[in] x : liczba
+ * @return współczynnik
+ */
+static inline poly_coeff_t CoeffReduce(poly_coeff_t x) {
+    return x;
+}
+
+/**
+ * Dodaje współczynniki dokładnie. Suma małych współczynników liczona jest
+ * w miejscu; wolna ścieżka tylko wtedy, gdy się przepełni.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @return @f$a + b@f$
+ */
+static inline poly_coeff_t CoeffAdd(poly_coeff_t a, poly_coeff_t b) {
+    long sum;
+    if (__builtin_expect(a.big == NULL && b.big == NULL &&
+                         !__builtin_add_overflow(a.small, b.small, &sum), 1))
+        return CoeffFromWord(sum);
+    return BigCoeffAdd(a, b);
+}
+
+/**
+ * Mnoży współczynniki dokładnie. Iloczyn małych współczynników liczony
+ * jest w miejscu; wolna ścieżka tylko wtedy, gdy się przepełni.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @return @f$a \cdot b@f$
+ */
+static inline poly_coeff_t CoeffMul(poly_coeff_t a, poly_coeff_t b) {
+    long product;
+    if (__builtin_expect(a.big == NULL && b.big == NULL &&
+                         !__builtin_mul_overflow(a.small, b.small, &product),
+                         1))
+        return CoeffFromWord(product);
+    return BigCoeffMul(a, b);
+}
+
+/**
+ * Zwraca współczynnik przeciwny.
+ * @param[in] a : współczynnik
+ * @return @f$-a@f$
+ */
+static inline poly_coeff_t CoeffNeg(poly_coeff_t a) {
+    if (a.big == NULL && a.small != LONG_MIN)
+        return CoeffFromWord(-a.small);
+    return BigCoeffNeg(a);
+}
+
+/**
+ * Sprawdza, czy współczynnik jest zerem.
+ * @param[in] a : współczynnik
+ * @return czy @f$a = 0@f$
+ */
+static inline bool CoeffIsZero(poly_coeff_t a) {
+    return a.big == NULL && a.small == 0;
+}
+
+/**
+ * Sprawdza równość współczynników. Duża liczba nigdy nie mieści się
+ * w typie long, więc nie jest równa małej.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @return czy @f$a = b@f$
+ */
+static inline bool CoeffEq(poly_coeff_t a, poly_coeff_t b) {
+    if (a.big == NULL || b.big == NULL)
+        return a.big == b.big && a.small == b.small;
+    return BigCoeffEq(a.big, b.big);
+}
+
+/**
+ * Tworzy kopię współczynnika.
+ * @param[in] a : współczynnik
+ * @return kopia
+ */
+static inline poly_coeff_t CoeffClone(poly_coeff_t a) {
+    return a.big == NULL ? a : BigCoeffClone(a.big);
+}
+
+/**
+ * Zwalnia pamięć współczynnika.
+ * @param[in] a : współczynnik
+ */
+static inline void CoeffDestroy(poly_coeff_t a) {
+    if (a.big != NULL)
+        BigCoeffFree(a.big);
+}
+
+/**
+ * Tworzy współczynnik z zapisu dziesiętnego, który nie mieści się
+ * w typie poly_coeff_word_t.
+ * @param[in] digits : cyfry
+ * @param[in] count : liczba cyfr
+ * @param[in] negative : czy liczba jest ujemna
+ * @param[out] coeff : współczynnik
+ * @return czy wariant pozwala przechować taką liczbę
+ */
+static inline bool CoeffFromDigits(const char digits[], size_t count,
+                                   bool negative, poly_coeff_t *coeff) {
+    *coeff = BigCoeffFromDigits(digits, count, negative);
+    return true;
+}
+
+#else
+
+/**
+ * Sprowadza liczbę do postaci współczynnika (tu: nic nie zmienia).
+ * @param[in] x : liczba
+ * @return współczynnik
+ */
+static inline poly_coeff_t CoeffReduce(poly_coeff_t x) {
+    return x;
+}
+
+/**
+ * Dodaje współczynniki modulo rozmiar typu.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @return @f$a + b@f$
+ */
+static inline poly_coeff_t CoeffAdd(poly_coeff_t a, poly_coeff_t b) {
+    return (poly_coeff_t) ((poly_ucoeff_t) a + (poly_ucoeff_t) b);
+}
+
+/**
+ * Mnoży współczynniki modulo rozmiar typu.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @return @f$a \cdot b@f$
+ */
+static inline poly_coeff_t CoeffMul(poly_coeff_t a, poly_coeff_t b) {
+    return (poly_coeff_t) ((poly_ucoeff_t) a * (poly_ucoeff_t) b);
+}
+
+/**
+ * Zwraca współczynnik przeciwny modulo rozmiar typu.
+ * @param[in] a : współczynnik
+ * @return @f$-a@f$
+ */
+static inline poly_coeff_t CoeffNeg(poly_coeff_t a) {
+    return (poly_coeff_t) (0 - (poly_ucoeff_t) a);
+}
+
+#endif
+
+#ifndef POLY_COEFF_BIG
+
+/**
+ * Zamienia liczbę na współczynnik.
+ * @param[in] x : liczba
+ * @return współczynnik
+ */
+static inline poly_coeff_t CoeffFromWord(poly_coeff_word_t x) {
+    return CoeffReduce(x);
+}
+
+/**
+ * Sprawdza, czy współczynnik jest zerem.
+ * @param[in] a : współczynnik
+ * @return czy @f$a = 0@f$
+ */
+static inline bool CoeffIsZero(poly_coeff_t a) {
+    return a == 0;
+}
+
+/**
+ * Sprawdza równość współczynników.
+ * @param[in] a : współczynnik
+ * @param[in] b : współczynnik
+ * @return czy @f$a = b@f$
+ */
+static inline bool CoeffEq(poly_coeff_t a, poly_coeff_t b) {
+    return a == b;
+}
+
+/**
+ * Tworzy kopię współczynnika (tu: zwraca go).
+ * @param[in] a : współczynnik
+ * @return kopia
+ */
+static inline poly_coeff_t CoeffClone(poly_coeff_t a) {
+    return a;
+}
+
+/**
+ * Zwalnia pamięć współczynnika (tu: nic nie robi).
+ * @param[in] a : współczynnik
+ */
+static inline void CoeffDestroy(poly_coeff_t a) {
+    (void) a;
+}
+
+/**
+ * Tworzy współczynnik z zapisu dziesiętnego, który nie mieści się
+ * w typie poly_coeff_word_t (tu: zawsze się nie udaje).
+ * @param[in] digits : cyfry
+ * @param[in] count : liczba cyfr
+ * @param[in] negative : czy liczba jest ujemna
+ * @param[out] coeff : współczynnik
+ * @return czy wariant pozwala przechować taką liczbę
+ */
+static inline bool CoeffFromDigits(const char digits[], size_t count,
+                                   bool negative, poly_coeff_t *coeff) {
+    (void) digits;
+    (void) count;
+    (void) negative;
+    (void) coeff;
+    return false;
+}
+
+#endif
+
+/**
+ * Zamienia liczbę na zapis dziesiętny. Cyfry są wpisywane od końca
+ * bufora @p digits.
+ * @param[in] x : liczba
+ * @param[out] digits : bufor na POLY_COEFF_DIGITS znaków
+ * @return indeks pierwszego znaku zapisu w buforze
+ */
+static inline size_t CoeffFormat(poly_coeff_word_t x,
+                                 char digits[POLY_COEFF_DIGITS]) {
+    // liczymy na typie bez znaku, żeby poprawnie obsłużyć najmniejszą wartość
+    poly_ucoeff_t magnitude = x < 0 ? 0 - (poly_ucoeff_t) x : (poly_ucoeff_t) x;
+    size_t begin = POLY_COEFF_DIGITS;
+#ifdef POLY_COEFF_INT128
+    // dzielenie 128-bitowe jest wolne, więc odcinamy po 19 cyfr
+    // i dzielimy dalej na 64 bitach
+    const unsigned long chunk_base = 10000000000000000000UL;
+    while (magnitude > ULONG_MAX) {
+        unsigned long chunk = (unsigned long) (magnitude % chunk_base);
+        magnitude /= chunk_base;
+        for (int j = 0; j < 19; j++) {
+            digits[--begin] = (char) ('0' + chunk % 10);
+            chunk /= 10;
+        }
+    }
+#endif
+    unsigned long rest = (unsigned long) magnitude;
+    do {
+        digits[--begin] = (char) ('0' + rest % 10);
+        rest /= 10;
+    } while (rest > 0);
+    if (x < 0) {
+        digits[--begin] = '-';
+    }
+    return begin;
+}
+
+/**
+ * Dopisuje zapis dziesiętny współczynnika do napisu.
+ * @param[in,out] out : napis
+ * @param[in] x : współczynnik
+ */
+static inline void CoeffAppend(StringWithSize *out, poly_coeff_t x) {
+    char digits[POLY_COEFF_DIGITS];
+#ifdef POLY_COEFF_BIG
+    if (x.big != NULL) {
+        BigCoeffAppend(out, x.big);
+        return;
+    }
+    size_t begin = CoeffFormat(x.small, digits);
+#else
+    size_t begin = CoeffFormat(x, digits);
+#endif
+    StringAppend(out, digits + begin, POLY_COEFF_DIGITS - begin);
+}
+
+/**
+ * Wypisuje zapis dziesiętny współczynnika.
+ * @param[in] x : współczynnik
+ */
+static inline void CoeffPrint(poly_coeff_t x) {
+    char digits[POLY_COEFF_DIGITS];
+#ifdef POLY_COEFF_BIG
+    if (x.big != NULL) {
+        BigCoeffPrint(x.big);
+        return;
+    }
+    size_t begin = CoeffFormat(x.small, digits);
+#else
+    size_t begin = CoeffFormat(x, digits);
+#endif
+    PrintBytes(digits + begin, POLY_COEFF_DIGITS - begin);
+}
+
+#endif //COEFF_H
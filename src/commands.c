@@ -0,0 +1,624 @@
+/** @file
+  Implementacja poleceń kalkulatora, ich wyszukiwania i wykonywania wierszy.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include "commands.h"
+#include "parsing.h"
+#include "input_output.h"
+#include "stack.h"
+#include "mallocs.h"
+#include "binary_io.h"
+#include "stats.h"
+#include "trace.h"
+#include "perf.h"
+
+/**
+ * Rozmiar tablicy haszującej poleceń (potęga dwójki).
+ */
+#define COMMAND_TABLE_SIZE 64
+
+bool binary_input = false;
+bool binary_output = false;
+
+/**
+ * Sprawdza, czy nie został przekroczony zakres danego typu
+ * przy parsowaniu funkcjami strto*.
+ * @return czy zakres został przekroczony?
+ */
+static bool IsInRange() {
+    if (errno == ERANGE) {
+        errno = 0;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Wypisuje odpowiedni błąd jeśli stos jest pusty.
+ * @param[in] empty : czy stos jest pusty
+ * @param[in] line : aktualny nr wiersza
+ * @return czy stos jest pusty?
+ */
+static bool TopIsEmpty(bool empty, int line) {
+    if (empty) {
+        PrintError(line, "STACK UNDERFLOW");
+        return true;
+    }
+    return false;
+}
+
+/**
+ * Odczytuje dwa wielomiany ze szczytu stosu będące argumentami polecenia,
+ * nie zdejmując ich. Argumenty zostają na stosie do czasu wyliczenia
+ * wyniku, więc nieudana alokacja w trakcie polecenia nie zmienia stosu.
+ * Jeśli na stosie jest mniej niż dwa wielomiany, wypisuje błąd.
+ * @param[in] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[out] p : wielomian ze szczytu stosu
+ * @param[out] q : wielomian spod szczytu stosu
+ * @return czy na stosie są oba wielomiany
+ */
+static bool TopTwo(PolyStack *stack, int line, Poly *p, Poly *q) {
+    if (TopIsEmpty(stack->size < 2, line))
+        return false;
+    *p = stack->polys[stack->size - 1];
+    *q = stack->polys[stack->size - 2];
+    return true;
+}
+
+/**
+ * Zastępuje na stosie argumenty polecenia jego wynikiem.
+ * Nie alokuje pamięci, bo stos się nie powiększa.
+ * @param[in,out] stack : stos
+ * @param[in] count : liczba argumentów na szczycie stosu (dodatnia)
+ * @param[in] result : wynik
+ */
+static void ReplaceTop(PolyStack *stack, size_t count, Poly result) {
+    for (size_t i = 0; i < count; i++) {
+        PolyDestroy(&stack->polys[stack->size - 1]);
+        StackPop(stack);
+    }
+    StackPush(stack, result);
+}
+
+/**
+ * Wykonuje polecenie ZERO.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : nieużywany
+ */
+static void ExecuteZero(PolyStack *stack, int line, CommandArg arg) {
+    (void) line;
+    (void) arg;
+    StackPush(stack, PolyZero());
+}
+
+/**
+ * Wykonuje polecenie IS_COEFF.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : nieużywany
+ */
+static void ExecuteIsCoeff(PolyStack *stack, int line, CommandArg arg) {
+    (void) arg;
+    bool empty;
+    Poly top = StackTop(stack, &empty);
+    if (TopIsEmpty(empty, line))
+        return;
+    PrintInt((int) PolyIsCoeff(&top));
+}
+
+/**
+ * Wykonuje polecenie IS_ZERO.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : nieużywany
+ */
+static void ExecuteIsZero(PolyStack *stack, int line, CommandArg arg) {
+    (void) arg;
+    bool empty;
+    Poly top = StackTop(stack, &empty);
+    if (TopIsEmpty(empty, line))
+        return;
+    PrintInt((int) PolyIsZero(&top));
+}
+
+/**
+ * Wykonuje polecenie CLONE.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : nieużywany
+ */
+static void ExecuteClone(PolyStack *stack, int line, CommandArg arg) {
+    (void) arg;
+    bool empty;
+    Poly top = StackTop(stack, &empty);
+    if (TopIsEmpty(empty, line))
+        return;
+    Poly clone = PolyClone(&top);
+    StackPush(stack, clone);
+}
+
+/**
+ * Wykonuje polecenie ADD.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : nieużywany
+ */
+static void ExecuteAdd(PolyStack *stack, int line, CommandArg arg) {
+    (void) arg;
+    Poly p, q;
+    if (!TopTwo(stack, line, &p, &q))
+        return;
+    ReplaceTop(stack, 2, PolyAdd(&p, &q));
+}
+
+/**
+ * Wykonuje polecenie MUL.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : nieużywany
+ */
+static void ExecuteMul(PolyStack *stack, int line, CommandArg arg) {
+    (void) arg;
+    Poly p, q;
+    if (!TopTwo(stack, line, &p, &q))
+        return;
+    ReplaceTop(stack, 2, PolyMul(&p, &q));
+}
+
+/**
+ * Wykonuje polecenie NEG.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : nieużywany
+ */
+static void ExecuteNeg(PolyStack *stack, int line, CommandArg arg) {
+    (void) arg;
+    bool empty;
+    Poly top = StackTop(stack, &empty);
+    if (TopIsEmpty(empty, line))
+        return;
+    ReplaceTop(stack, 1, PolyNeg(&top));
+}
+
+/**
+ * Wykonuje polecenie SUB.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : nieużywany
+ */
+static void ExecuteSub(PolyStack *stack, int line, CommandArg arg) {
+    (void) arg;
+    Poly p, q;
+    if (!TopTwo(stack, line, &p, &q))
+        return;
+    ReplaceTop(stack, 2, PolySub(&p, &q));
+}
+
+/**
+ * Wykonuje polecenie IS_EQ.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : nieużywany
+ */
+static void ExecuteIsEq(PolyStack *stack, int line, CommandArg arg) {
+    (void) arg;
+    Poly p, q;
+    if (!TopTwo(stack, line, &p, &q))
+        return;
+    PrintInt((int) PolyIsEq(&p, &q));
+}
+
+/**
+ * Wykonuje polecenie DEG.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : nieużywany
+ */
+static void ExecuteDeg(PolyStack *stack, int line, CommandArg arg) {
+    (void) arg;
+    bool empty;
+    Poly top = StackTop(stack, &empty);
+    if (TopIsEmpty(empty, line))
+        return;
+    PrintInt(PolyDeg(&top));
+}
+
+/**
+ * Wykonuje polecenie PRINT.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : nieużywany
+ */
+static void ExecutePrint(PolyStack *stack, int line, CommandArg arg) {
+    (void) arg;
+    bool empty;
+    Poly top = StackTop(stack, &empty);
+    if (TopIsEmpty(empty, line))
+        return;
+    if (binary_output) {
+        PolyPrintBinary(&top);
+    } else {
+        PolyPrint(&top);
+        PrintChar('\n');
+    }
+}
+
+/**
+ * Wykonuje polecenie POP.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : nieużywany
+ */
+static void ExecutePop(PolyStack *stack, int line, CommandArg arg) {
+    (void) arg;
+    bool empty;
+    Poly top = StackTop(stack, &empty);
+    if (TopIsEmpty(empty, line))
+        return;
+    PolyDestroy(&top);
+    StackPop(stack);
+}
+
+/**
+ * Wykonuje polecenie DEG_BY.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : indeks zmiennej
+ */
+static void ExecuteDegBy(PolyStack *stack, int line, CommandArg arg) {
+    bool empty;
+    Poly top = StackTop(stack, &empty);
+    if (TopIsEmpty(empty, line))
+        return;
+    PrintInt(PolyDegBy(&top, (size_t) arg.index));
+}
+
+/**
+ * Wykonuje polecenie AT.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : wartość, w której wyliczamy wielomian
+ */
+static void ExecuteAt(PolyStack *stack, int line, CommandArg arg) {
+    bool empty;
+    Poly top = StackTop(stack, &empty);
+    if (TopIsEmpty(empty, line)) {
+        CoeffDestroy(arg.value);
+        return;
+    }
+    Poly p = PolyAt(&top, arg.value);
+    CoeffDestroy(arg.value);
+    ReplaceTop(stack, 1, p);
+}
+
+/**
+ * Wykonuje polecenie COMPOSE.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : liczba wielomianów do podstawienia
+ */
+static void ExecuteCompose(PolyStack *stack, int line, CommandArg arg) {
+    bool empty;
+    unsigned long long k = arg.index;
+
+    if (k > stack->capacity) {
+        PrintError(line, "STACK UNDERFLOW");
+        return;
+    }
+    Poly p = StackTop(stack, &empty);
+    if (TopIsEmpty(empty, line) || TopIsEmpty(stack->size <= k, line))
+        return;
+
+    // podstawiane wielomiany leżą na stosie w odwrotnej kolejności
+    Poly *q = k > 0 ? SafeBytesMalloc(k * sizeof(Poly)) : NULL;
+    for (unsigned long long j = 0; j < k; j++) {
+        q[j] = stack->polys[stack->size - 2 - j];
+    }
+    Poly composed = PolyCompose(&p, (size_t) k, q);
+    BytesFree(q, k * sizeof(Poly));
+    ReplaceTop(stack, (size_t) k + 1, composed);
+}
+
+/**
+ * Wykonuje polecenie MEMSTATS: wypisuje liczniki pamięci programu
+ * (zaalokowane i największe zużycie w bajtach, liczby alokacji, realokacji
+ * i zwolnień). Gdy wątek ma budżet pamięci (sesja serwera), liczniki
+ * programu obejmują też inne sesje, więc wypisywane jest tylko zużycie
+ * i limit budżetu.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : nieużywany
+ */
+static void ExecuteMemStats(PolyStack *stack, int line, CommandArg arg) {
+    (void) stack;
+    (void) line;
+    (void) arg;
+    const MemoryBudget *budget = GetMemoryBudget();
+    if (budget != NULL) {
+        PrintString("live=");
+        PrintLong((long) budget->live_bytes);
+        PrintString(" limit=");
+        PrintLong((long) budget->limit);
+        PrintChar('\n');
+        return;
+    }
+    MemoryStats stats = GetMemoryStats();
+    PrintString("live=");
+    PrintLong((long) stats.live_bytes);
+    PrintString(" peak=");
+    PrintLong((long) stats.peak_bytes);
+    PrintString(" allocs=");
+    PrintLong((long) stats.allocs);
+    PrintString(" reallocs=");
+    PrintLong((long) stats.reallocs);
+    PrintString(" frees=");
+    PrintLong((long) stats.frees);
+    PrintChar('\n');
+}
+
+/**
+ * Parsuje argument będący liczbą nieujemną (DEG_BY, COMPOSE).
+ * @param[in] arg : pierwszy znak argumentu
+ * @param[in] end : wskaźnik na znak '\\n' kończący wiersz
+ * @param[out] result : sparsowany argument
+ * @return czy argument jest poprawny
+ */
+static bool ParseIndexArg(const char arg[], const char *end,
+                          CommandArg *result) {
+    char *endptr;
+    // niedozwolony znak (np. więcej niż jedna spacja lub minus)
+    if (!IsDigit(arg[0]))
+        return false;
+    result->index = strtoull(arg, &endptr, 10);
+    // przekroczono zakres lub są jakieś dalsze znaki
+    return IsInRange() && endptr == end;
+}
+
+/**
+ * Parsuje argument będący wartością współczynnika (AT).
+ * @param[in] arg : pierwszy znak argumentu
+ * @param[in] end : wskaźnik na znak '\\n' kończący wiersz
+ * @param[out] result : sparsowany argument
+ * @return czy argument jest poprawny
+ */
+static bool ParseValueArg(const char arg[], const char *end,
+                          CommandArg *result) {
+    size_t length = (size_t) (end - arg);
+    StringWithSize str = {.A = (char *) arg, .length = length,
+                          .size = length};
+    return CoeffFromString(str, 0, length, &result->value);
+}
+
+/**
+ * Tablica wszystkich poleceń kalkulatora.
+ * Nowe polecenie wystarczy dopisać tutaj.
+ */
+static const Command commands[] = {
+    {"ZERO", ExecuteZero, NULL, NULL},
+    {"IS_COEFF", ExecuteIsCoeff, NULL, NULL},
+    {"IS_ZERO", ExecuteIsZero, NULL, NULL},
+    {"CLONE", ExecuteClone, NULL, NULL},
+    {"ADD", ExecuteAdd, NULL, NULL},
+    {"MUL", ExecuteMul, NULL, NULL},
+    {"NEG", ExecuteNeg, NULL, NULL},
+    {"SUB", ExecuteSub, NULL, NULL},
+    {"IS_EQ", ExecuteIsEq, NULL, NULL},
+    {"DEG", ExecuteDeg, NULL, NULL},
+    {"PRINT", ExecutePrint, NULL, NULL},
+    {"POP", ExecutePop, NULL, NULL},
+    {"DEG_BY", ExecuteDegBy, ParseIndexArg, "DEG BY WRONG VARIABLE"},
+    {"AT", ExecuteAt, ParseValueArg, "AT WRONG VALUE"},
+    {"COMPOSE", ExecuteCompose, ParseIndexArg, "COMPOSE WRONG PARAMETER"},
+    {"MEMSTATS", ExecuteMemStats, NULL, NULL},
+};
+
+/**
+ * Tablica haszująca z adresowaniem otwartym, wskazująca na polecenia.
+ */
+static const Command *command_table[COMMAND_TABLE_SIZE];
+
+/**
+ * Gwarantuje jednokrotne zbudowanie tablicy haszującej.
+ */
+static pthread_once_t command_table_once = PTHREAD_ONCE_INIT;
+
+/**
+ * Liczy hasz nazwy polecenia (FNV-1a).
+ * @param[in] word : nazwa
+ * @param[in] length : długość nazwy
+ * @return indeks w tablicy haszującej
+ */
+static size_t CommandHash(const char word[], size_t length) {
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (unsigned char) word[i]) * 16777619u;
+    }
+    return hash & (COMMAND_TABLE_SIZE - 1);
+}
+
+/**
+ * Wstawia wszystkie polecenia do tablicy haszującej.
+ */
+static void BuildCommandTable(void) {
+    size_t count = sizeof(commands) / sizeof(commands[0]);
+    assert(count < COMMAND_TABLE_SIZE);
+
+    for (size_t i = 0; i < count; i++) {
+        size_t h = CommandHash(commands[i].name, strlen(commands[i].name));
+        while (command_table[h] != NULL) {
+            h = (h + 1) & (COMMAND_TABLE_SIZE - 1);
+        }
+        command_table[h] = &commands[i];
+    }
+}
+
+const Command *FindCommand(const char word[], size_t length) {
+    if (pthread_once(&command_table_once, BuildCommandTable) != 0)
+        exit(1);
+
+    size_t h = CommandHash(word, length);
+    while (command_table[h] != NULL) {
+        const Command *command = command_table[h];
+        if (strncmp(command->name, word, length) == 0 &&
+            command->name[length] == '\0') {
+            return command;
+        }
+        h = (h + 1) & (COMMAND_TABLE_SIZE - 1);
+    }
+    return NULL;
+}
+
+Poly PolyFromLine(StringWithSize str, bool *correct, bool *in_range) {
+    if (binary_input && IsBinaryRecord(str))
+        return PolyFromBinary(str, correct, in_range);
+    return PolyFromString(str, 0, str.length - 1, correct, in_range);
+}
+
+void WordIsPoly(StringWithSize str, int line, PolyStack *stack) {
+    StatsSample sample;
+    if (stats_enabled)
+        sample = StatsBegin();
+
+    PerfSample counters;
+    if (perf_enabled)
+        counters = PerfBegin();
+
+    TraceSpan span = TraceBegin();
+    bool correct, in_range;
+    Poly p = PolyFromLine(str, &correct, &in_range);
+    TraceEnd(&span, STATS_POLY_NAME, TRACE_PARSE, line);
+
+    span = TraceBegin();
+    if (correct && in_range) {
+        StackPush(stack, p);
+    } else {
+        PrintError(line, "WRONG POLY");
+    }
+    TraceEnd(&span, STATS_POLY_NAME, TRACE_EXECUTE, line);
+
+    if (perf_enabled)
+        PerfEnd(&counters, STATS_POLY_NAME);
+    if (stats_enabled)
+        StatsEnd(&sample, STATS_POLY_NAME, line, stack);
+}
+
+bool IsCommandLine(StringWithSize str) {
+    char first = str.A[0];
+    return (first >= 'A' && first <= 'Z') || (first >= 'a' && first <= 'z');
+}
+
+/**
+ * Wykonuje polecenie, w trybie statystyk i liczników sprzętowych mierząc
+ * jego koszt, a przy zapisie przebiegu zapisując przedział wykonania.
+ * @param[in] command : polecenie
+ * @param[in,out] stack : stos
+ * @param[in] line : nr wiersza
+ * @param[in] arg : sparsowany argument
+ */
+static void ExecuteCommand(const Command *command, PolyStack *stack, int line,
+                           CommandArg arg) {
+    TraceSpan span = TraceBegin();
+    PerfSample counters;
+    if (perf_enabled)
+        counters = PerfBegin();
+    if (!stats_enabled) {
+        command->execute(stack, line, arg);
+    } else {
+        StatsSample sample = StatsBegin();
+        command->execute(stack, line, arg);
+        StatsEnd(&sample, command->name, line, stack);
+    }
+    if (perf_enabled)
+        PerfEnd(&counters, command->name);
+    TraceEnd(&span, command->name, TRACE_EXECUTE, line);
+}
+
+/**
+ * Rozpoznaje polecenie w wierszu i parsuje jego argument.
+ * Nie modyfikuje wiersza.
+ * @param[in] str : wiersz
+ * @param[out] arg : sparsowany argument
+ * @param[out] error : opis błędu, jeśli wiersz nie jest poprawnym poleceniem
+ * @return polecenie lub NULL, jeśli wiersz nie jest poprawnym poleceniem
+ */
+static const Command *ParseCommand(StringWithSize str, CommandArg *arg,
+                                   char **error) {
+    size_t l = 1;
+    while (str.A[l] != '\n' && str.A[l] != ' ' &&
+           (str.A[l] < 9 || str.A[l] > 13)) {
+        // dopóki nie natrafimy na znak biały
+        if (str.A[l] == '\0') {
+            *error = "WRONG COMMAND";
+            return NULL;
+        }
+        l++;
+    }
+
+    const Command *command = FindCommand(str.A, l);
+    if (command == NULL) {
+        *error = "WRONG COMMAND";
+        return NULL;
+    }
+    if (command->parse_arg == NULL) {
+        // po poleceniu bezargumentowym musi od razu kończyć się wiersz
+        if (l == str.length - 1)
+            return command;
+        *error = "WRONG COMMAND";
+        return NULL;
+    }
+    if (str.A[l] == ' ' &&
+        command->parse_arg(&str.A[l + 1], &str.A[str.length - 1], arg))
+        return command;
+    // błąd bo brak argumentu, niedozwolony znak lub zły argument
+    *error = command->arg_error;
+    return NULL;
+}
+
+void AnalyzeCommand(StringWithSize str, int line, PolyStack *stack) {
+    TraceSpan span = TraceBegin();
+    CommandArg arg = {0};
+    char *error = NULL;
+    const Command *command = ParseCommand(str, &arg, &error);
+    TraceEnd(&span, command != NULL ? command->name : "WRONG COMMAND",
+             TRACE_PARSE, line);
+
+    if (command != NULL) {
+        ExecuteCommand(command, stack, line, arg);
+    } else {
+        PrintError(line, error);
+    }
+}
+
+void AnalyzeLine(StringWithSize str, int line, PolyStack *stack) {
+    assert(str.length >= 1);
+
+    if (str.A[0] == '\n')
+        return;
+
+    if (IsCommandLine(str)) {
+        AnalyzeCommand(str, line, stack);
+    } else {
+        WordIsPoly(str, line, stack);
+    }
+}
+
+void ExecuteLines(InputReader *reader, PolyStack *stack) {
+    StringWithSize str;
+    int line = 1;
+
+    while (ReadLine(reader, &str)) {
+        AnalyzeLine(str, line, stack);
+        line++;
+    }
+}
@@ -0,0 +1,122 @@
+/** @file
+  Tablica poleceń kalkulatora i funkcje wykonujące polecenia i wiersze.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#ifndef COMMANDS_H
+#define COMMANDS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "poly.h"
+#include "stack.h"
+#include "input_output.h"
+
+/**
+ * Czy na wejściu rozpoznawane są binarne rekordy wielomianów?
+ */
+extern bool binary_input;
+
+/**
+ * Czy polecenie PRINT wypisuje wielomiany jako binarne rekordy?
+ */
+extern bool binary_output;
+
+/**
+ * To jest unia przechowująca sparsowany argument polecenia.
+ */
+typedef union CommandArg {
+    unsigned long long index; ///< nieujemny argument (DEG_BY, COMPOSE)
+    poly_coeff_t value; ///< wartość argumentu (AT)
+} CommandArg;
+
+/**
+ * To jest typ funkcji wykonującej polecenie na stosie.
+ * @param[in,out] stack : stos
+ * @param[in] line : aktualny nr wiersza
+ * @param[in] arg : sparsowany argument (nieużywany przez polecenia
+ * bezargumentowe)
+ */
+typedef void (*CommandHandler)(PolyStack *stack, int line, CommandArg arg);
+
+/**
+ * To jest typ funkcji parsującej argument polecenia.
+ * @param[in] arg : pierwszy znak argumentu
+ * @param[in] end : wskaźnik na znak '\\n' kończący wiersz
+ * @param[out] result : sparsowany argument
+ * @return czy argument jest poprawny
+ */
+typedef bool (*ArgParser)(const char arg[], const char *end,
+                          CommandArg *result);
+
+/**
+ * To jest struktura opisująca polecenie kalkulatora.
+ */
+typedef struct Command {
+    const char *name; ///< nazwa polecenia
+    CommandHandler execute; ///< funkcja wykonująca polecenie
+    ArgParser parse_arg; ///< parser argumentu, NULL dla poleceń bezargumentowych
+    char *arg_error; ///< opis błędu dla niepoprawnego argumentu
+} Command;
+
+/**
+ * Wyszukuje polecenie o podanej nazwie w tablicy haszującej poleceń.
+ * @param[in] word : nazwa polecenia (nie musi być zakończona znakiem '\\0')
+ * @param[in] length : długość nazwy
+ * @return polecenie lub NULL, jeśli nie ma polecenia o takiej nazwie
+ */
+const Command *FindCommand(const char word[], size_t length);
+
+/**
+ * Parsuje wiersz reprezentujący wielomian: zapis tekstowy lub,
+ * w trybie --binary-io, binarny rekord.
+ * @param[in] str : wiersz
+ * @param[out] correct : czy wielomian jest poprawny
+ * @param[out] in_range : czy liczby mieszczą się w zakresach
+ * @return wielomian
+ */
+Poly PolyFromLine(StringWithSize str, bool *correct, bool *in_range);
+
+/**
+ * Jeśli napis reprezentuje wielomian, zostaje wrzucony na stos.
+ * @param[in] str : napis
+ * @param[in] line : aktualny nr wiersza
+ * @param[in,out] stack : stos
+ */
+void WordIsPoly(StringWithSize str, int line, PolyStack *stack);
+
+/**
+ * Sprawdza, czy niepusty wiersz jest poleceniem (zaczyna się od litery),
+ * a nie wielomianem.
+ * @param[in] str : wiersz
+ * @return czy wiersz jest poleceniem
+ */
+bool IsCommandLine(StringWithSize str);
+
+/**
+ * Wykonuje wiersz będący poleceniem albo wypisuje odpowiedni błąd.
+ * Nie modyfikuje wiersza.
+ * @param[in] str : wiersz zaczynający się od litery
+ * @param[in] line : aktualny nr wiersza
+ * @param[in,out] stack : stos
+ */
+void AnalyzeCommand(StringWithSize str, int line, PolyStack *stack);
+
+/**
+ * Analizuje wiersz pod kątem bycia wielomianem, komendą lub niepoprawnym.
+ * @param[in] str : wiersz
+ * @param[in] line : aktualny nr wiersza
+ * @param[in,out] stack : stos
+ */
+void AnalyzeLine(StringWithSize str, int line, PolyStack *stack);
+
+/**
+ * Wczytuje i kolejno wykonuje wszystkie wiersze wejścia.
+ * @param[in,out] reader : bufor wejścia
+ * @param[in,out] stack : stos
+ */
+void ExecuteLines(InputReader *reader, PolyStack *stack);
+
+#endif //COMMANDS_H
@@ -5,9 +5,17 @@
   @date 2021
 */
 
+#define _DEFAULT_SOURCE
+
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "input_output.h"
 #include "mallocs.h"
 
@@ -19,38 +27,505 @@ StringWithSize StringInit() {
     return str;
 }
 
-void ReadLine(StringWithSize *str, char first, bool *was_eof) {
-    char c = '\0';
-    str->length = 0;
+/**
+ * Mapuje standardowe wejście do pamięci, jeśli jest niepustym zwykłym
+ * plikiem. Mapowanie jest prywatne i zapisywalne, bo komentarze
+ * zamieniamy w miejscu na puste wiersze.
+ * @param[in,out] reader : bufor wejścia
+ */
+static void MapInput(InputReader *reader) {
+    struct stat info;
+    off_t offset = lseek(STDIN_FILENO, 0, SEEK_CUR);
+    if (offset < 0 || fstat(STDIN_FILENO, &info) != 0 ||
+        !S_ISREG(info.st_mode) || info.st_size <= offset ||
+        (unsigned long long) info.st_size > SIZE_MAX)
+        return;
+
+    size_t size = (size_t) info.st_size;
+    void *mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                         STDIN_FILENO, 0);
+    if (mapping == MAP_FAILED)
+        return;
+    madvise(mapping, size, MADV_SEQUENTIAL);
+    reader->mapping = mapping;
+    reader->mapping_size = size;
+    reader->begin = (size_t) offset;
+}
+
+InputReader ReaderInitDescriptor(int fd) {
+    InputReader reader;
+    reader.buffer = StringInit();
+    reader.buffer.size = INPUT_BLOCK_SIZE;
+    SafeStringMalloc(&reader.buffer);
+    reader.begin = 0;
+    reader.checked = 0;
+    reader.eof = false;
+    reader.flush_output = true;
+    reader.mapping = NULL;
+    reader.mapping_size = 0;
+    reader.released = 0;
+    reader.binary = false;
+    reader.fd = fd;
+    return reader;
+}
+
+InputReader ReaderInit() {
+    InputReader reader = ReaderInitDescriptor(STDIN_FILENO);
+    MapInput(&reader);
+    return reader;
+}
+
+void ReaderClear(InputReader *reader) {
+    if (reader->mapping != NULL) {
+        munmap(reader->mapping, reader->mapping_size);
+        // wejście jest przeczytane, jakbyśmy czytali je blokami
+        lseek(STDIN_FILENO, (off_t) reader->begin, SEEK_SET);
+    }
+    StringFree(&reader->buffer);
+    *reader = (InputReader) {.buffer = StringInit()};
+}
+
+/**
+ * Wczytuje co najwyżej @p count znaków wejścia. Standardowe wejście
+ * czytamy funkcją fread, która czeka na cały blok, a inne deskryptory
+ * funkcją read, która oddaje to, co już nadeszło.
+ * @param[in] reader : bufor wejścia
+ * @param[out] A : miejsce na wczytane znaki
+ * @param[in] count : maksymalna liczba znaków
+ * @return liczba wczytanych znaków, 0 na końcu wejścia lub po błędzie
+ */
+static size_t ReadInput(const InputReader *reader, char A[], size_t count) {
+    if (reader->fd == STDIN_FILENO)
+        return fread(A, 1, count, stdin);
+
+    ssize_t result;
+    do {
+        result = read(reader->fd, A, count);
+    } while (result < 0 && errno == EINTR);
+    return result < 0 ? 0 : (size_t) result;
+}
+
+/**
+ * Dowczytuje kolejny blok wejścia do bufora. Nieprzetworzony fragment
+ * przesuwa na początek bufora, a jeśli bufor jest pełny - powiększa go.
+ * Zawsze zostawia jeden wolny znak na '\n' kończący ostatni wiersz.
+ * @param[in,out] reader : bufor wejścia
+ */
+static void FillBuffer(InputReader *reader) {
+    StringWithSize *buffer = &reader->buffer;
+
+    if (reader->begin > 0) {
+        size_t rest = buffer->length - reader->begin;
+        memmove(buffer->A, buffer->A + reader->begin, rest);
+        buffer->length = rest;
+        reader->begin = 0;
+    }
+    ReallocStringIfNecessary(buffer);
+    if (reader->flush_output) {
+        // zanim zaczekamy na dalsze wejście, oddajemy dotychczasowe wyniki
+        FlushOutput();
+    }
 
-    ReallocStringIfNecessary(str);
-    str->A[0] = first;
-    (str->length)++;
-    if (first == '#') {
-        str->A[0] = '\n';
-        do {
-            c = (char) getchar();
-        } while (c != '\n' && c != EOF);
-    } else if (first != '\n') {
-        do {
-            c = (char) getchar();
-            ReallocStringIfNecessary(str);
-            str->A[str->length] = c;
-            (str->length)++;
-        } while (c != '\n' && c != EOF);
+    size_t free_space = buffer->size - buffer->length - 1;
+    size_t read = ReadInput(reader, buffer->A + buffer->length, free_space);
+    buffer->length += read;
+    if (read == 0) {
+        reader->eof = true;
     }
-    if (c == EOF) {
-        str->A[str->length - 1] = '\n';
-        *was_eof = true;
+}
+
+/**
+ * Ustawia wiersz na fragment pamięci zakończony znakiem '\n'.
+ * Komentarz zamienia na pusty wiersz.
+ * @param[out] line : wiersz
+ * @param[in] A : początek wiersza
+ * @param[in] length : długość wiersza razem z '\n'
+ */
+static void SetLine(StringWithSize *line, char *A, size_t length) {
+    line->A = A;
+    line->length = length;
+    line->size = length;
+
+    if (line->A[0] == '#') { // komentarz traktujemy jak pusty wiersz
+        line->A[0] = '\n';
+        line->length = 1;
     }
 }
 
+/**
+ * Udostępnia wiersz zaczynający się na początku nieprzetworzonej części
+ * bufora i kończący się znakiem '\n' na pozycji @p newline.
+ * @param[in,out] reader : bufor wejścia
+ * @param[in] newline : indeks znaku '\n' kończącego wiersz
+ * @param[out] line : wiersz
+ */
+static void TakeLine(InputReader *reader, size_t newline, StringWithSize *line) {
+    SetLine(line, reader->buffer.A + reader->begin,
+            newline - reader->begin + 1);
+    reader->begin = newline + 1;
+    reader->checked = 0;
+}
+
+/**
+ * Oddaje systemowi przetworzone strony zmapowanego wejścia, żeby zużycie
+ * pamięci nie rosło z rozmiarem wejścia. Poprzednio udostępniony wiersz
+ * przestaje być wtedy ważny.
+ * @param[in,out] reader : bufor wejścia
+ */
+static void ReleaseMapping(InputReader *reader) {
+    if (reader->begin - reader->released < INPUT_RELEASE_SIZE)
+        return;
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    size_t end = reader->begin / page * page;
+    madvise(reader->mapping + reader->released, end - reader->released,
+            MADV_DONTNEED);
+    reader->released = end;
+}
+
+/**
+ * Udostępnia kolejny wiersz zmapowanego wejścia. Tylko ostatni wiersz
+ * zakończony EOF-em jest kopiowany do bufora, bo za mapowaniem może nie
+ * być miejsca na dopisanie mu '\n'.
+ * @param[in,out] reader : bufor wejścia
+ * @param[out] line : wczytany wiersz
+ * @return czy udało się wczytać wiersz (false oznacza koniec wejścia)
+ */
+static bool ReadMappedLine(InputReader *reader, StringWithSize *line) {
+    if (reader->begin == reader->mapping_size)
+        return false;
+
+    char *from = reader->mapping + reader->begin;
+    size_t available = reader->mapping_size - reader->begin;
+    char *newline = memchr(from, '\n', available);
+    if (newline != NULL) {
+        size_t length = (size_t) (newline - from) + 1;
+        reader->begin += length;
+        SetLine(line, from, length);
+        return true;
+    }
+
+    if (available + 1 > reader->buffer.size)
+        SafeStringRealloc(&reader->buffer, available + 1);
+    memcpy(reader->buffer.A, from, available);
+    reader->buffer.A[available] = '\n';
+    reader->begin += available;
+    SetLine(line, reader->buffer.A, available + 1);
+    return true;
+}
+
+/**
+ * Wczytuje do bufora co najmniej @p count nieprzetworzonych znaków,
+ * o ile wejście się wcześniej nie skończy.
+ * @param[in,out] reader : bufor wejścia
+ * @param[in] count : liczba znaków
+ * @return liczba dostępnych nieprzetworzonych znaków
+ */
+static size_t EnsureAvailable(InputReader *reader, size_t count) {
+    if (reader->mapping != NULL)
+        return reader->mapping_size - reader->begin;
+    while (reader->buffer.length - reader->begin < count && !reader->eof) {
+        FillBuffer(reader);
+    }
+    return reader->buffer.length - reader->begin;
+}
+
+/**
+ * Udostępnia binarny rekord wielomianu zaczynający się na początku
+ * nieprzetworzonej części wejścia. Rekord dłuższy niż reszta wejścia
+ * jest ucinany.
+ * @param[in,out] reader : bufor wejścia
+ * @param[out] line : rekord
+ * @return czy rekord ma poprawny nagłówek; jeśli nie, nie jest
+ * udostępniany i należy go wczytać jak zwykły wiersz
+ */
+static bool ReadRecord(InputReader *reader, StringWithSize *line) {
+    size_t available = EnsureAvailable(reader, 1 + VARINT_MAX_LENGTH);
+    char *base = reader->mapping != NULL ? reader->mapping : reader->buffer.A;
+    unsigned long long length;
+    size_t header = DecodeVarint(base + reader->begin + 1, available - 1,
+                                 &length);
+    if (header == 0 || length >= SIZE_MAX - 1 - header)
+        return false;
+
+    size_t total = 1 + header + (size_t) length;
+    available = EnsureAvailable(reader, total);
+    if (total > available)
+        total = available;
+    base = reader->mapping != NULL ? reader->mapping : reader->buffer.A;
+    line->A = base + reader->begin;
+    line->length = total;
+    line->size = total;
+    reader->begin += total;
+    reader->checked = 0;
+    return true;
+}
+
+bool ReadLine(InputReader *reader, StringWithSize *line) {
+    StringWithSize *buffer = &reader->buffer;
+
+    if (reader->mapping != NULL)
+        ReleaseMapping(reader);
+    if (reader->binary && EnsureAvailable(reader, 1) > 0) {
+        char *base = reader->mapping != NULL ? reader->mapping : buffer->A;
+        if (base[reader->begin] == BINARY_RECORD_MARKER &&
+            ReadRecord(reader, line))
+            return true;
+    }
+    if (reader->mapping != NULL)
+        return ReadMappedLine(reader, line);
+
+    while (true) {
+        size_t from = reader->begin + reader->checked;
+        size_t available = buffer->length - from;
+        char *newline = memchr(buffer->A + from, '\n', available);
+
+        if (newline != NULL) {
+            TakeLine(reader, (size_t) (newline - buffer->A), line);
+            return true;
+        }
+        reader->checked += available;
+
+        if (reader->eof) {
+            if (reader->begin == buffer->length) {
+                return false;
+            }
+            // ostatni wiersz zakończony EOF-em - dopisujemy mu '\n'
+            buffer->A[buffer->length] = '\n';
+            TakeLine(reader, buffer->length, line);
+            buffer->length++;
+            return true;
+        }
+        FillBuffer(reader);
+    }
+}
+
+/**
+ * To jest struktura buforująca wyjście do deskryptora.
+ */
+typedef struct OutputBuffer {
+    char A[OUTPUT_BUFFER_SIZE]; ///< zawartość bufora
+    size_t length; ///< liczba znaków w buforze
+    int fd; ///< deskryptor docelowy
+    bool redirected; ///< czy to bufor przekierowania (RedirectOutput)
+    bool failed; ///< czy zapis przekierowania się nie powiódł
+} OutputBuffer;
+
+/** Bufor standardowego wyjścia. */
+static OutputBuffer standard_output = {.fd = STDOUT_FILENO};
+
+/** Bufor standardowego wyjścia błędów. */
+static OutputBuffer standard_error = {.fd = STDERR_FILENO};
+
+/** Bufor, do którego bieżący wątek wypisuje wyniki. */
+static _Thread_local OutputBuffer *current_output = &standard_output;
+
+/** Bufor, do którego bieżący wątek wypisuje błędy. */
+static _Thread_local OutputBuffer *current_error = &standard_error;
+
+/** Czy FlushOutput zostało już zarejestrowane do wywołania przy wyjściu? */
+static bool flush_registered = false;
+
+/**
+ * Zapisuje zawartość bufora do jego deskryptora. W wypadku niepowodzenia
+ * zapisu standardowego wyjścia kończy program z kodem 1 funkcją _Exit,
+ * bo może być wywołana przy wyjściu. Niepowodzenie zapisu przekierowania
+ * jest tylko zapamiętywane, a dalsze wyniki są pomijane.
+ * @param[in,out] out : bufor
+ */
+static void FlushBuffer(OutputBuffer *out) {
+    size_t written = 0;
+    while (written < out->length && !out->failed) {
+        ssize_t result = write(out->fd, out->A + written,
+                               out->length - written);
+        if (result > 0) {
+            written += (size_t) result;
+        } else if (result < 0 && errno != EINTR) {
+            if (!out->redirected)
+                _Exit(1);
+            out->failed = true;
+        }
+    }
+    out->length = 0;
+}
+
+void FlushOutput(void) {
+    FlushBuffer(current_output);
+    if (current_error != current_output)
+        FlushBuffer(current_error);
+}
+
+void RedirectOutput(int fd) {
+    if (current_output->redirected) {
+        FlushBuffer(current_output);
+        free(current_output);
+    }
+    current_output = &standard_output;
+    current_error = &standard_error;
+    if (fd < 0)
+        return;
+
+    OutputBuffer *out = malloc(sizeof(OutputBuffer));
+    if (out == NULL) {
+        AllocationFailed();
+    }
+    out->length = 0;
+    out->fd = fd;
+    out->redirected = true;
+    out->failed = false;
+    // wyniki i błędy trafiają do jednego bufora, żeby zachować ich kolejność
+    current_output = current_error = out;
+}
+
+bool OutputFailed(void) {
+    return current_output->failed;
+}
+
+/**
+ * Przy pierwszym użyciu standardowych buforów rejestruje ich opróżnienie
+ * przy wyjściu z programu.
+ * @param[in] out : bufor, do którego piszemy
+ */
+static inline void RegisterFlush(const OutputBuffer *out) {
+    if (!out->redirected && !flush_registered) {
+        flush_registered = true;
+        if (atexit(FlushOutput) != 0) {
+            exit(1);
+        }
+    }
+}
+
+/**
+ * Dopisuje znaki do bufora, opróżniając go, gdy się zapełni.
+ * @param[in,out] out : bufor
+ * @param[in] s : znaki do dopisania
+ * @param[in] length : liczba znaków
+ */
+static void BufferWrite(OutputBuffer *out, const char s[], size_t length) {
+    RegisterFlush(out);
+    while (length > 0) {
+        if (out->length == OUTPUT_BUFFER_SIZE) {
+            FlushBuffer(out);
+        }
+        size_t chunk = OUTPUT_BUFFER_SIZE - out->length;
+        if (chunk > length) {
+            chunk = length;
+        }
+        memcpy(out->A + out->length, s, chunk);
+        out->length += chunk;
+        s += chunk;
+        length -= chunk;
+    }
+}
+
+/**
+ * Maksymalna liczba znaków zapisu dziesiętnego liczby typu long.
+ */
+#define LONG_DIGITS 20
+
+/**
+ * Zamienia liczbę na zapis dziesiętny. Cyfry są wpisywane od końca
+ * bufora @p digits.
+ * @param[in] x : liczba
+ * @param[out] digits : bufor na co najmniej LONG_DIGITS znaków
+ * @return indeks pierwszego znaku zapisu w buforze
+ */
+static size_t FormatLong(long x, char digits[]) {
+    // liczymy na typie bez znaku, żeby poprawnie obsłużyć LONG_MIN
+    unsigned long magnitude = x < 0 ? -(unsigned long) x : (unsigned long) x;
+    size_t begin = LONG_DIGITS;
+    do {
+        digits[--begin] = (char) ('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (x < 0) {
+        digits[--begin] = '-';
+    }
+    return begin;
+}
+
+void StringAppend(StringWithSize *str, const char s[], size_t length) {
+    if (str->length + length > str->size) {
+        size_t size = str->size > 0 ? str->size : OUTPUT_BUFFER_SIZE;
+        while (str->length + length > size) {
+            size = MultiplySize(size);
+        }
+        SafeStringRealloc(str, size);
+    }
+    memcpy(str->A + str->length, s, length);
+    str->length += length;
+}
+
+size_t EncodeVarint(unsigned long long x, char bytes[]) {
+    size_t length = 0;
+    while (x >= 0x80) {
+        bytes[length++] = (char) ((x & 0x7f) | 0x80);
+        x >>= 7;
+    }
+    bytes[length++] = (char) x;
+    return length;
+}
+
+void StringAppendVarint(StringWithSize *str, unsigned long long x) {
+    char bytes[VARINT_MAX_LENGTH];
+    StringAppend(str, bytes, EncodeVarint(x, bytes));
+}
+
+size_t DecodeVarint(const char A[], size_t length, unsigned long long *value) {
+    unsigned long long x = 0;
+    for (size_t i = 0; i < length && i < VARINT_MAX_LENGTH; i++) {
+        unsigned long long byte = (unsigned char) A[i];
+        if (i == VARINT_MAX_LENGTH - 1 && byte > 1)
+            return 0; // więcej niż 64 bity
+        x |= (byte & 0x7f) << (7 * i);
+        if (byte < 0x80) {
+            *value = x;
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+void StringAppendLong(StringWithSize *str, long x) {
+    char digits[LONG_DIGITS];
+    size_t begin = FormatLong(x, digits);
+    StringAppend(str, digits + begin, LONG_DIGITS - begin);
+}
+
+void PrintBytes(const char s[], size_t length) {
+    BufferWrite(current_output, s, length);
+}
+
+void PrintChar(char c) {
+    OutputBuffer *out = current_output;
+    RegisterFlush(out);
+    if (out->length == OUTPUT_BUFFER_SIZE) {
+        FlushBuffer(out);
+    }
+    out->A[out->length++] = c;
+}
+
+void PrintString(const char s[]) {
+    BufferWrite(current_output, s, strlen(s));
+}
+
+void PrintLong(long x) {
+    char digits[LONG_DIGITS];
+    size_t begin = FormatLong(x, digits);
+    BufferWrite(current_output, digits + begin, LONG_DIGITS - begin);
+}
+
 void PrintError(int line_number, char description[]) {
-    if (fprintf(stderr, "ERROR %d %s\n", line_number, description) < 0)
-        exit(1);
+    char digits[LONG_DIGITS];
+    size_t begin = FormatLong(line_number, digits);
+    OutputBuffer *out = current_error;
+    BufferWrite(out, "ERROR ", 6);
+    BufferWrite(out, digits + begin, LONG_DIGITS - begin);
+    BufferWrite(out, " ", 1);
+    BufferWrite(out, description, strlen(description));
+    BufferWrite(out, "\n", 1);
 }
 
 void PrintInt(int x) {
-    if (printf("%d\n", x) < 0)
-        exit(1);
+    PrintLong(x);
+    PrintChar('\n');
 }
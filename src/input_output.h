@@ -9,6 +9,17 @@
 #define INPUT_OUTPUT_H
 
 #include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Rozmiar bloku, którym wczytujemy standardowe wejście.
+ */
+#define INPUT_BLOCK_SIZE 65536
+
+/**
+ * Rozmiar bufora wyjścia.
+ */
+#define OUTPUT_BUFFER_SIZE 65536
 
 /**
  * To jest struktura przechowująca napis wraz z jego długością
@@ -16,7 +27,7 @@
  */
 typedef struct StringWithSize {
     char *A; ///< napis
-    int length; ///< długość napisu
+    size_t length; ///< długość napisu
     size_t size; ///< na ile elementów została zaalokowana pamięć
 } StringWithSize;
 
@@ -27,24 +38,188 @@ typedef struct StringWithSize {
 StringWithSize StringInit();
 
 /**
- * Wczytuje wiersz ze standardowego wejścia.
- * @param[out] str : wczytany wiersz
- * @param[in] first : pierwszy znak wiersza, wczytany wcześniej
- * @param[out] was_eof : czy wiersz zakończył się EOF-em
+ * Pierwszy bajt binarnego rekordu wielomianu (tryb --binary-io).
+ * Po nim następuje długość treści rekordu w kodowaniu varint i sama treść.
+ */
+#define BINARY_RECORD_MARKER '\x01'
+
+/**
+ * Maksymalna długość zapisu liczby 64-bitowej w kodowaniu varint.
+ */
+#define VARINT_MAX_LENGTH 10
+
+/**
+ * Co ile bajtów przetworzonego zmapowanego wejścia oddajemy jego strony
+ * systemowi.
+ */
+#define INPUT_RELEASE_SIZE (16 * INPUT_BLOCK_SIZE)
+
+/**
+ * To jest struktura buforująca standardowe wejście.
+ * Wejście wczytywane jest dużymi blokami do bufora, a kolejne wiersze
+ * są udostępniane jako fragmenty tego bufora, bez kopiowania.
+ * Jeśli standardowe wejście jest zwykłym plikiem, jest ono mapowane do
+ * pamięci i wiersze dowolnej długości są fragmentami mapowania.
+ */
+typedef struct InputReader {
+    StringWithSize buffer; ///< bufor, @p length to liczba wczytanych znaków
+    size_t begin; ///< indeks pierwszego nieprzetworzonego znaku bufora
+    size_t checked; ///< ile znaków od @p begin na pewno nie jest '\n'
+    bool eof; ///< czy wejście już się skończyło
+    bool flush_output; ///< czy opróżniać bufory wyjścia przed czekaniem na wejście
+    char *mapping; ///< zmapowane wejście lub NULL, jeśli czytamy je blokami
+    size_t mapping_size; ///< rozmiar zmapowanego wejścia
+    size_t released; ///< ile początkowych bajtów mapowania oddaliśmy systemowi
+    bool binary; ///< czy rozpoznawać binarne rekordy wielomianów
+    int fd; ///< deskryptor czytanego wejścia
+} InputReader;
+
+/**
+ * Tworzy bufor wejścia o początkowym rozmiarze INPUT_BLOCK_SIZE.
+ * Jeśli standardowe wejście jest niepustym zwykłym plikiem, mapuje je
+ * do pamięci, wtedy @p begin jest indeksem w mapowaniu.
+ * @return bufor wejścia
+ */
+InputReader ReaderInit();
+
+/**
+ * Tworzy bufor wejścia czytający z deskryptora @p fd (np. gniazda sesji
+ * serwera). Blok jest dowczytywany tym, co już nadeszło, bez czekania
+ * na zapełnienie bufora, więc na każde polecenie można odpowiedzieć
+ * przed nadejściem kolejnego.
+ * @param[in] fd : deskryptor wejścia
+ * @return bufor wejścia
+ */
+InputReader ReaderInitDescriptor(int fd);
+
+/**
+ * Usuwa bufor wejścia z pamięci.
+ * @param[in] reader : bufor wejścia
+ */
+void ReaderClear(InputReader *reader);
+
+/**
+ * Wczytuje kolejny wiersz ze standardowego wejścia.
+ * Wiersz jest zawsze zakończony znakiem '\n' (również ostatni wiersz
+ * zakończony EOF-em), a komentarz zostaje zamieniony na pusty wiersz.
+ * Jeśli @p binary jest ustawione, a wiersz zaczyna się od
+ * BINARY_RECORD_MARKER, zamiast wiersza udostępniany jest cały binarny
+ * rekord (bez dodatkowego '\n'; ucięty na końcu wejścia, jeśli jest
+ * niekompletny).
+ * Wiersz wskazuje na pamięć bufora i jest ważny do następnego wywołania.
+ * @param[in,out] reader : bufor wejścia
+ * @param[out] line : wczytany wiersz
+ * @return czy udało się wczytać wiersz (false oznacza koniec wejścia)
+ */
+bool ReadLine(InputReader *reader, StringWithSize *line);
+
+/**
+ * Dopisuje znaki do napisu, powiększając go w razie potrzeby.
+ * W przypadku błędu funkcji realloc wywołuje AllocationFailed.
+ * @param[in,out] str : napis
+ * @param[in] s : znaki do dopisania
+ * @param[in] length : liczba znaków
+ */
+void StringAppend(StringWithSize *str, const char s[], size_t length);
+
+/**
+ * Zapisuje liczbę w kodowaniu varint (po 7 bitów w bajcie, od najmniej
+ * znaczących, najstarszy bit oznacza kolejny bajt).
+ * @param[in] x : liczba
+ * @param[out] bytes : bufor na co najmniej VARINT_MAX_LENGTH bajtów
+ * @return długość zapisu
+ */
+size_t EncodeVarint(unsigned long long x, char bytes[]);
+
+/**
+ * Dopisuje do napisu liczbę w kodowaniu varint.
+ * @param[in,out] str : napis
+ * @param[in] x : liczba do dopisania
+ */
+void StringAppendVarint(StringWithSize *str, unsigned long long x);
+
+/**
+ * Odczytuje liczbę w kodowaniu varint.
+ * @param[in] A : początek zapisu
+ * @param[in] length : liczba dostępnych bajtów
+ * @param[out] value : odczytana liczba
+ * @return liczba bajtów zapisu lub 0, jeśli zapis jest niekompletny
+ * lub nie mieści się w 64 bitach
+ */
+size_t DecodeVarint(const char A[], size_t length, unsigned long long *value);
+
+/**
+ * Dopisuje do napisu liczbę całkowitą w zapisie dziesiętnym.
+ * @param[in,out] str : napis
+ * @param[in] x : liczba do dopisania
+ */
+void StringAppendLong(StringWithSize *str, long x);
+
+/**
+ * Wypisuje znaki na standardowe wyjście (przez bufor wyjścia).
+ * @param[in] s : znaki do wypisania
+ * @param[in] length : liczba znaków
+ */
+void PrintBytes(const char s[], size_t length);
+
+/**
+ * Wypisuje znak na standardowe wyjście (przez bufor wyjścia).
+ * @param[in] c : znak do wypisania
  */
-void ReadLine(StringWithSize *str, char first, bool *was_eof);
+void PrintChar(char c);
 
 /**
- * Wypisuje błąd na stderr. W wypadku niepowodzenia, kończy program z kodem 1.
+ * Wypisuje napis na standardowe wyjście (przez bufor wyjścia).
+ * @param[in] s : napis zakończony znakiem '\0'
+ */
+void PrintString(const char s[]);
+
+/**
+ * Wypisuje liczbę całkowitą w zapisie dziesiętnym, bez znaku nowej linii,
+ * na standardowe wyjście (przez bufor wyjścia).
+ * @param[in] x : liczba do wypisania
+ */
+void PrintLong(long x);
+
+/**
+ * Wypisuje błąd na stderr (przez bufor wyjścia błędów).
  * @param[in] line_number : nr wiersza, w którym wystąpił błąd
  * @param[in] description : opis błędu
  */
 void PrintError(int line_number, char description[]);
 
 /**
- * Wypisuje liczbę całkowitą. W wypadku niepowodzenia, kończy program z kodem 1.
+ * Wypisuje liczbę całkowitą zakończoną znakiem nowej linii.
  * @param[in] x : liczba do wypisania
  */
 void PrintInt(int x);
 
+/**
+ * Zapisuje zawartość buforów wyjścia i wyjścia błędów bieżącego wątku.
+ * Bufory są opróżniane także po zapełnieniu, przed wczytaniem kolejnego
+ * bloku wejścia oraz przy zakończeniu programu.
+ * W wypadku niepowodzenia zapisu na standardowe wyjścia, kończy program
+ * z kodem 1.
+ */
+void FlushOutput(void);
+
+/**
+ * Kieruje wyniki i błędy wypisywane przez bieżący wątek do wspólnego
+ * bufora zapisywanego do deskryptora @p fd (np. gniazda sesji serwera),
+ * a przy ujemnym @p fd - z powrotem na standardowe wyjścia.
+ * Poprzedni bufor przekierowania jest opróżniany i zwalniany.
+ * Nieudany zapis do deskryptora nie kończy programu, tylko sprawia,
+ * że kolejne wyniki są pomijane (zob. OutputFailed).
+ * W przypadku błędu funkcji malloc wywołuje AllocationFailed.
+ * @param[in] fd : deskryptor lub -1
+ */
+void RedirectOutput(int fd);
+
+/**
+ * Czy zapis przekierowanego wyjścia bieżącego wątku się nie powiódł
+ * (np. klient sesji się rozłączył)?
+ * @return czy zapis się nie powiódł
+ */
+bool OutputFailed(void);
+
 #endif //INPUT_OUTPUT_H
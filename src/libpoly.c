@@ -0,0 +1,151 @@
+/** @file
+  Implementacja biblioteki libpoly.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+#include "libpoly.h"
+#include "mallocs.h"
+#include "parsing.h"
+#include "input_output.h"
+
+/**
+ * Wykonuje instrukcję tak, że nieudana alokacja kończy wołającą funkcję
+ * kodem POLY_ERROR_NO_MEMORY zamiast kończyć program, zwalniając pamięć
+ * zaalokowaną przez przerwaną instrukcję. Obszary alokacji się zagnieżdżają,
+ * więc funkcje biblioteki można wywoływać wewnątrz innych obszarów.
+ * @param[in] statement : instrukcja
+ */
+#define GUARDED(statement)                                          \
+    do {                                                            \
+        AllocationGuard guard;                                      \
+        BeginAllocationGuard(&guard);                               \
+        if (setjmp(guard.handler) != 0)                             \
+            return POLY_ERROR_NO_MEMORY;                            \
+        statement;                                                  \
+        EndAllocationGuard(&guard);                                 \
+    } while (0)
+
+const char *PolyErrorString(PolyError error) {
+    switch (error) {
+        case POLY_OK:
+            return "OK";
+        case POLY_ERROR_NO_MEMORY:
+            return "OUT OF MEMORY";
+        case POLY_ERROR_SYNTAX:
+            return "WRONG POLY";
+        case POLY_ERROR_RANGE:
+            return "NUMBER OUT OF RANGE";
+        case POLY_ERROR_STACK_UNDERFLOW:
+            return "STACK UNDERFLOW";
+    }
+    return "UNKNOWN ERROR";
+}
+
+PolyError PolyLibClone(const Poly *p, Poly *result) {
+    GUARDED(*result = PolyClone(p));
+    return POLY_OK;
+}
+
+PolyError PolyLibAdd(const Poly *p, const Poly *q, Poly *result) {
+    GUARDED(*result = PolyAdd(p, q));
+    return POLY_OK;
+}
+
+PolyError PolyLibSub(const Poly *p, const Poly *q, Poly *result) {
+    GUARDED(*result = PolySub(p, q));
+    return POLY_OK;
+}
+
+PolyError PolyLibMul(const Poly *p, const Poly *q, Poly *result) {
+    GUARDED(*result = PolyMul(p, q));
+    return POLY_OK;
+}
+
+PolyError PolyLibNeg(const Poly *p, Poly *result) {
+    GUARDED(*result = PolyNeg(p));
+    return POLY_OK;
+}
+
+PolyError PolyLibAt(const Poly *p, poly_coeff_t x, Poly *result) {
+    GUARDED(*result = PolyAt(p, x));
+    return POLY_OK;
+}
+
+PolyError PolyLibPower(const Poly *p, poly_exp_t exp, Poly *result) {
+    GUARDED(*result = PolyPower(p, exp));
+    return POLY_OK;
+}
+
+PolyError PolyLibCompose(const Poly *p, size_t k, const Poly q[],
+                         Poly *result) {
+    GUARDED(*result = PolyCompose(p, k, q));
+    return POLY_OK;
+}
+
+PolyError PolyLibAddMonos(size_t count, const Mono monos[], Poly *result) {
+    GUARDED(*result = PolyAddMonos(count, monos));
+    return POLY_OK;
+}
+
+PolyError PolyLibFromString(const char *text, size_t length, Poly *result) {
+    StringWithSize str = {.A = (char *) text, .length = length,
+                          .size = length};
+    bool correct, in_range;
+    Poly p;
+    GUARDED(p = PolyFromString(str, 0, length, &correct, &in_range));
+    if (!in_range)
+        return POLY_ERROR_RANGE;
+    if (!correct)
+        return POLY_ERROR_SYNTAX;
+    *result = p;
+    return POLY_OK;
+}
+
+PolyError PolyLibToString(const Poly *p, char **text, size_t *length) {
+    StringWithSize str = StringInit();
+    GUARDED(PolyFormat(p, &str));
+
+    // napis oddajemy w pamięci zaalokowanej zwykłym malloc, żeby wołający
+    // mógł ją zwolnić funkcją free
+    char *copy = malloc(str.length + 1);
+    if (copy == NULL) {
+        StringFree(&str);
+        return POLY_ERROR_NO_MEMORY;
+    }
+    memcpy(copy, str.A, str.length);
+    copy[str.length] = '\0';
+    if (length != NULL)
+        *length = str.length;
+    *text = copy;
+    StringFree(&str);
+    return POLY_OK;
+}
+
+PolyError PolyLibStackInit(PolyStack *stack) {
+    GUARDED(*stack = StackInit(INITIAL_STACK_SIZE));
+    return POLY_OK;
+}
+
+PolyError PolyLibStackPush(PolyStack *stack, Poly p) {
+    GUARDED(StackPush(stack, p));
+    return POLY_OK;
+}
+
+PolyError PolyLibStackPop(PolyStack *stack, Poly *result) {
+    bool empty;
+    Poly top = StackTop(stack, &empty);
+    if (empty)
+        return POLY_ERROR_STACK_UNDERFLOW;
+    StackPop(stack);
+    *result = top;
+    return POLY_OK;
+}
+
+void PolyLibStackClear(PolyStack *stack) {
+    StackClear(stack);
+}
@@ -0,0 +1,185 @@
+/** @file
+  Interfejs biblioteki libpoly: operacje na wielomianach, parsowanie
+  i stos wielomianów z kodami błędów zamiast kończenia programu.
+
+  Funkcje PolyLib* korzystają tylko z atomowych liczników pamięci
+  (mallocs.h) i danych bieżącego wątku, więc różne wątki mogą jednocześnie
+  operować na różnych wielomianach. Biblioteka zawiera jeszcze następujące
+  zmienne globalne bez blokad, które funkcje PolyLib* tylko czytają:
+  - liczby wątków parsowania i wypisywania (parse_threads, print_threads),
+    zmieniane przez SetParseThreads i SetPrintThreads,
+  - stan zapisu przebiegu (trace.c), zmieniany przez TraceOpen i TraceClose;
+    same zdarzenia zapisywane są pod blokadą.
+  Funkcje ustawiające te zmienne należy wywołać, zanim wątki zaczną używać
+  biblioteki; domyślnie wielowątkowe parsowanie i wypisywanie oraz zapis
+  przebiegu są wyłączone. Funkcja PolyPrint pisze do wspólnych buforów
+  standardowego wyjścia i błędów (standard_output, standard_error
+  w input_output.c) i nie jest przeznaczona do użycia z wielu wątków -
+  zamiast niej należy używać PolyLibToString. Statystyki, liczniki
+  sprzętowe i polecenia kalkulatora nie należą do biblioteki.
+
+  Funkcje niealokujące pamięci (PolyDestroy, PolyDeg, PolyIsEq itd.)
+  używane są bezpośrednio z poly.h.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#ifndef LIBPOLY_H
+#define LIBPOLY_H
+
+#include <stddef.h>
+#include "poly.h"
+#include "stack.h"
+
+/**
+ * To jest typ kodów błędów funkcji biblioteki.
+ */
+typedef enum PolyError {
+    POLY_OK = 0, ///< operacja się powiodła
+    POLY_ERROR_NO_MEMORY, ///< zabrakło pamięci
+    POLY_ERROR_SYNTAX, ///< napis nie jest poprawnym wielomianem
+    POLY_ERROR_RANGE, ///< liczba w napisie nie mieści się w zakresie typu
+    POLY_ERROR_STACK_UNDERFLOW ///< na stosie jest za mało wielomianów
+} PolyError;
+
+/**
+ * Zwraca opis kodu błędu.
+ * @param[in] error : kod błędu
+ * @return opis
+ */
+const char *PolyErrorString(PolyError error);
+
+/**
+ * Robi pełną kopię wielomianu.
+ * W przypadku błędu wynik pozostaje niezmieniony, a pamięć zaalokowana
+ * przez przerwaną operację jest zwalniana (dotyczy to wszystkich funkcji
+ * biblioteki).
+ * @param[in] p : wielomian
+ * @param[out] result : skopiowany wielomian
+ * @return kod błędu
+ */
+PolyError PolyLibClone(const Poly *p, Poly *result);
+
+/**
+ * Dodaje dwa wielomiany.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[out] result : @f$p + q@f$
+ * @return kod błędu
+ */
+PolyError PolyLibAdd(const Poly *p, const Poly *q, Poly *result);
+
+/**
+ * Odejmuje wielomian od wielomianu.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[out] result : @f$p - q@f$
+ * @return kod błędu
+ */
+PolyError PolyLibSub(const Poly *p, const Poly *q, Poly *result);
+
+/**
+ * Mnoży dwa wielomiany.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[out] result : @f$p * q@f$
+ * @return kod błędu
+ */
+PolyError PolyLibMul(const Poly *p, const Poly *q, Poly *result);
+
+/**
+ * Zwraca przeciwny wielomian.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[out] result : @f$-p@f$
+ * @return kod błędu
+ */
+PolyError PolyLibNeg(const Poly *p, Poly *result);
+
+/**
+ * Wylicza wartość wielomianu w punkcie @p x.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] x : wartość argumentu @f$x@f$
+ * @param[out] result : @f$p(x, x_0, x_1, \ldots)@f$
+ * @return kod błędu
+ */
+PolyError PolyLibAt(const Poly *p, poly_coeff_t x, Poly *result);
+
+/**
+ * Podnosi wielomian do potęgi.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] exp : wykładnik @f$n@f$
+ * @param[out] result : @f$p^n@f$
+ * @return kod błędu
+ */
+PolyError PolyLibPower(const Poly *p, poly_exp_t exp, Poly *result);
+
+/**
+ * Składa wielomian @p p z wielomianami @p q.
+ * @param[in] p : wielomian
+ * @param[in] k : liczba wielomianów @p q
+ * @param[in] q : wielomiany podstawiane za kolejne zmienne
+ * @param[out] result : złożenie
+ * @return kod błędu
+ */
+PolyError PolyLibCompose(const Poly *p, size_t k, const Poly q[],
+                         Poly *result);
+
+/**
+ * Sumuje listę jednomianów, nie modyfikując ich.
+ * @param[in] count : liczba jednomianów
+ * @param[in] monos : tablica jednomianów
+ * @param[out] result : suma jednomianów
+ * @return kod błędu
+ */
+PolyError PolyLibAddMonos(size_t count, const Mono monos[], Poly *result);
+
+/**
+ * Parsuje wielomian w postaci nawiasowo-plusowej.
+ * @param[in] text : napis (nie musi być zakończony znakiem '\0')
+ * @param[in] length : długość napisu
+ * @param[out] result : sparsowany wielomian
+ * @return kod błędu
+ */
+PolyError PolyLibFromString(const char *text, size_t length, Poly *result);
+
+/**
+ * Zapisuje wielomian w postaci nawiasowo-plusowej.
+ * @param[in] p : wielomian
+ * @param[out] text : napis zakończony znakiem '\0', do zwolnienia funkcją free
+ * @param[out] length : długość napisu (bez '\0'), może być NULL
+ * @return kod błędu
+ */
+PolyError PolyLibToString(const Poly *p, char **text, size_t *length);
+
+/**
+ * Tworzy pusty stos wielomianów.
+ * @param[out] stack : stos
+ * @return kod błędu
+ */
+PolyError PolyLibStackInit(PolyStack *stack);
+
+/**
+ * Wstawia wielomian na stos, przejmując go na własność. W przypadku
+ * błędu stos pozostaje nienaruszony, a wielomian należy do wołającego.
+ * @param[in,out] stack : stos
+ * @param[in] p : wielomian
+ * @return kod błędu
+ */
+PolyError PolyLibStackPush(PolyStack *stack, Poly p);
+
+/**
+ * Zdejmuje wielomian ze szczytu stosu i przekazuje go wołającemu.
+ * @param[in,out] stack : stos
+ * @param[out] result : wielomian ze szczytu
+ * @return kod błędu
+ */
+PolyError PolyLibStackPop(PolyStack *stack, Poly *result);
+
+/**
+ * Usuwa stos i wszystkie jego wielomiany z pamięci.
+ * @param[in,out] stack : stos
+ */
+void PolyLibStackClear(PolyStack *stack);
+
+#endif //LIBPOLY_H
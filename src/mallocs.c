@@ -6,49 +6,501 @@
 */
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
 #include "mallocs.h"
 #include "input_output.h"
 #include "stack.h"
 
+/**
+ * Liczniki alokacji tablic jednomianów bieżącego wątku. Każdy wątek ma
+ * własne liczniki, więc ich zwiększanie nie wymaga synchronizacji.
+ */
+static _Thread_local MonoAllocCounters mono_counters;
+
+/** Liczba bajtów aktualnie zaalokowanych. */
+static atomic_llong live_bytes;
+/** Największa dotychczasowa wartość live_bytes. */
+static atomic_llong peak_bytes;
+/** Liczba alokacji. */
+static atomic_ullong alloc_count;
+/** Liczba realokacji. */
+static atomic_ullong realloc_count;
+/** Liczba zwolnień. */
+static atomic_ullong free_count;
+
+/** Budżet pamięci bieżącego wątku lub NULL. */
+static _Thread_local MemoryBudget *memory_budget = NULL;
+
+/**
+ * Uwzględnia w licznikach zmianę rozmiaru zaalokowanej pamięci.
+ * Liczniki są zmieniane bez narzucania kolejności względem innych operacji
+ * na pamięci - potrzebujemy tylko, żeby żadna zmiana nie została zgubiona.
+ * @param[in] old_bytes : poprzedni rozmiar
+ * @param[in] new_bytes : nowy rozmiar
+ */
+static void TrackBytes(size_t old_bytes, size_t new_bytes) {
+    long long delta = (long long) new_bytes - (long long) old_bytes;
+    if (memory_budget != NULL)
+        memory_budget->live_bytes += delta;
+    long long live = atomic_fetch_add_explicit(&live_bytes, delta,
+                                               memory_order_relaxed) + delta;
+    if (delta <= 0)
+        return;
+
+    long long peak = atomic_load_explicit(&peak_bytes, memory_order_relaxed);
+    while (live > peak &&
+           !atomic_compare_exchange_weak_explicit(&peak_bytes, &peak, live,
+                                                  memory_order_relaxed,
+                                                  memory_order_relaxed)) {
+    }
+}
+
+/**
+ * Uwzględnia w licznikach alokację.
+ * @param[in] bytes : rozmiar zaalokowanej pamięci
+ */
+static void TrackAlloc(size_t bytes) {
+    atomic_fetch_add_explicit(&alloc_count, 1, memory_order_relaxed);
+    TrackBytes(0, bytes);
+}
+
+/**
+ * Uwzględnia w licznikach realokację.
+ * @param[in] old_bytes : poprzedni rozmiar
+ * @param[in] new_bytes : nowy rozmiar
+ */
+static void TrackRealloc(size_t old_bytes, size_t new_bytes) {
+    atomic_fetch_add_explicit(&realloc_count, 1, memory_order_relaxed);
+    TrackBytes(old_bytes, new_bytes);
+}
+
+/**
+ * Uwzględnia w licznikach zwolnienie pamięci.
+ * @param[in] bytes : rozmiar zwalnianej pamięci
+ */
+static void TrackFree(size_t bytes) {
+    atomic_fetch_add_explicit(&free_count, 1, memory_order_relaxed);
+    TrackBytes(bytes, 0);
+}
+
+MonoAllocCounters GetMonoAllocCounters(void) {
+    return mono_counters;
+}
+
+void AddMonoAllocCounters(MonoAllocCounters counters) {
+    mono_counters.allocs += counters.allocs;
+    mono_counters.bytes += counters.bytes;
+}
+
+MemoryStats GetMemoryStats(void) {
+    MemoryStats stats;
+    stats.live_bytes = atomic_load_explicit(&live_bytes, memory_order_relaxed);
+    stats.peak_bytes = atomic_load_explicit(&peak_bytes, memory_order_relaxed);
+    stats.allocs = atomic_load_explicit(&alloc_count, memory_order_relaxed);
+    stats.reallocs = atomic_load_explicit(&realloc_count,
+                                          memory_order_relaxed);
+    stats.frees = atomic_load_explicit(&free_count, memory_order_relaxed);
+    return stats;
+}
+
+void ResetPeakMemory(void) {
+    atomic_store_explicit(&peak_bytes,
+                          atomic_load_explicit(&live_bytes,
+                                               memory_order_relaxed),
+                          memory_order_relaxed);
+}
+
+/**
+ * Początkowa liczba miejsc w tablicy zarejestrowanych alokacji.
+ */
+#define REGISTRY_MIN_CAPACITY 64
+
+/**
+ * To jest struktura opisująca alokację zarejestrowaną w obszarze.
+ */
+typedef struct RegisteredBlock {
+    void *ptr; ///< zaalokowana pamięć lub NULL, jeśli miejsce jest wolne
+    size_t bytes; ///< rozmiar pamięci
+    unsigned long long number; ///< nr alokacji
+} RegisteredBlock;
+
+/** Ostatnio rozpoczęty obszar bieżącego wątku lub NULL. */
+static _Thread_local AllocationGuard *current_guard = NULL;
+
+/**
+ * Alokacje bieżącego wątku zarejestrowane w jego obszarach: tablica
+ * haszująca z adresowaniem liniowym, zapełniona co najwyżej w połowie.
+ * Sama tablica nie jest doliczana do liczników ani budżetu pamięci.
+ */
+static _Thread_local RegisteredBlock *registry = NULL;
+/** Liczba miejsc w tablicy registry (potęga dwójki). */
+static _Thread_local size_t registry_capacity = 0;
+/** Liczba zarejestrowanych alokacji. */
+static _Thread_local size_t registry_count = 0;
+/** Nr następnej alokacji bieżącego wątku w obszarze. */
+static _Thread_local unsigned long long next_block_number = 0;
+
+/**
+ * Zwraca miejsce, od którego szukamy alokacji w tablicy.
+ * @param[in] ptr : zaalokowana pamięć
+ * @return nr miejsca
+ */
+static size_t HomeSlot(const void *ptr) {
+    unsigned long long x = (uintptr_t) ptr;
+    return (size_t) ((x * 0x9E3779B97F4A7C15ULL) >> 32) &
+           (registry_capacity - 1);
+}
+
+/**
+ * Wstawia alokację do tablicy, w której jest wolne miejsce.
+ * @param[in] block : alokacja
+ */
+static void PlaceBlock(RegisteredBlock block) {
+    size_t i = HomeSlot(block.ptr);
+    while (registry[i].ptr != NULL) {
+        i = (i + 1) & (registry_capacity - 1);
+    }
+    registry[i] = block;
+    registry_count++;
+}
+
+/**
+ * Wyszukuje alokację w tablicy.
+ * @param[in] ptr : zaalokowana pamięć
+ * @return nr miejsca alokacji lub registry_capacity, jeśli jej nie ma
+ */
+static size_t FindSlot(const void *ptr) {
+    if (registry_count == 0)
+        return registry_capacity;
+    size_t i = HomeSlot(ptr);
+    while (registry[i].ptr != NULL) {
+        if (registry[i].ptr == ptr)
+            return i;
+        i = (i + 1) & (registry_capacity - 1);
+    }
+    return registry_capacity;
+}
+
+/**
+ * Usuwa alokację z tablicy, przesuwając wstecz alokacje, które dalej
+ * nie byłyby osiągalne z ich miejsc początkowych.
+ * @param[in] i : nr miejsca alokacji
+ */
+static void RemoveSlot(size_t i) {
+    size_t mask = registry_capacity - 1;
+    registry[i].ptr = NULL;
+    for (size_t j = (i + 1) & mask; registry[j].ptr != NULL;
+         j = (j + 1) & mask) {
+        size_t home = HomeSlot(registry[j].ptr);
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            registry[i] = registry[j];
+            registry[j].ptr = NULL;
+            i = j;
+        }
+    }
+    registry_count--;
+}
+
+/**
+ * Powiększa dwukrotnie tablicę zarejestrowanych alokacji.
+ * @return czy się udało
+ */
+static bool GrowRegistry(void) {
+    size_t capacity = registry_capacity == 0 ? REGISTRY_MIN_CAPACITY :
+                      2 * registry_capacity;
+    RegisteredBlock *table = calloc(capacity, sizeof(RegisteredBlock));
+    if (table == NULL)
+        return false;
+
+    RegisteredBlock *old = registry;
+    size_t old_capacity = registry_capacity;
+    registry = table;
+    registry_capacity = capacity;
+    registry_count = 0;
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old[i].ptr != NULL)
+            PlaceBlock(old[i]);
+    }
+    free(old);
+    return true;
+}
+
+/**
+ * Zwalnia tablicę zarejestrowanych alokacji (bez samych alokacji).
+ */
+static void FreeRegistry(void) {
+    free(registry);
+    registry = NULL;
+    registry_capacity = 0;
+    registry_count = 0;
+}
+
+/**
+ * Rejestruje nową alokację w bieżącym obszarze, jeśli jakiś trwa.
+ * Jeśli nie da się jej zarejestrować, zwalnia ją i wywołuje
+ * AllocationFailed, więc trzeba ją rejestrować przed doliczeniem
+ * do liczników.
+ * @param[in] ptr : zaalokowana pamięć
+ * @param[in] bytes : rozmiar pamięci
+ */
+static void RegisterBlock(void *ptr, size_t bytes) {
+    if (current_guard == NULL)
+        return;
+    if (2 * (registry_count + 1) > registry_capacity && !GrowRegistry()) {
+        free(ptr);
+        AllocationFailed();
+    }
+    PlaceBlock((RegisteredBlock) {.ptr = ptr, .bytes = bytes,
+                                  .number = next_block_number++});
+}
+
+/**
+ * Uwzględnia w rejestrze realokację. Alokacja sprzed obszaru nadal
+ * do niego nie należy, a realokacja pamięci NULL jest nową alokacją.
+ * @param[in] old : poprzedni adres pamięci lub NULL
+ * @param[in] ptr : nowy adres pamięci
+ * @param[in] bytes : nowy rozmiar pamięci
+ */
+static void MoveBlock(void *old, void *ptr, size_t bytes) {
+    if (current_guard == NULL)
+        return;
+    if (old == NULL) {
+        RegisterBlock(ptr, bytes);
+        return;
+    }
+    size_t i = FindSlot(old);
+    if (i == registry_capacity)
+        return;
+    RegisteredBlock block = registry[i];
+    RemoveSlot(i);
+    block.ptr = ptr;
+    block.bytes = bytes;
+    PlaceBlock(block);
+}
+
+/**
+ * Usuwa z rejestru zwalnianą alokację, jeśli była zarejestrowana.
+ * @param[in] ptr : zwalniana pamięć
+ */
+static void ForgetBlock(const void *ptr) {
+    if (current_guard == NULL)
+        return;
+    size_t i = FindSlot(ptr);
+    if (i != registry_capacity)
+        RemoveSlot(i);
+}
+
+/**
+ * Zwalnia zarejestrowane alokacje o numerach od @p first.
+ * @param[in] first : nr pierwszej zwalnianej alokacji
+ */
+static void ReleaseBlocks(unsigned long long first) {
+    if (registry_count == 0)
+        return;
+    size_t mask = registry_capacity - 1, empty = 0;
+    for (size_t i = 0; i < registry_capacity; i++) {
+        if (registry[i].ptr != NULL && registry[i].number >= first) {
+            TrackFree(registry[i].bytes);
+            free(registry[i].ptr);
+            registry[i].ptr = NULL;
+            registry_count--;
+        }
+        if (registry[i].ptr == NULL)
+            empty = i;
+    }
+
+    // pozostałe alokacje wstawiamy ponownie, żeby zwolnione miejsca
+    // nie przerywały ich ciągów; zaczynamy za wolnym miejscem
+    for (size_t k = 1; k <= registry_capacity; k++) {
+        size_t i = (empty + k) & mask;
+        if (registry[i].ptr != NULL) {
+            RegisteredBlock block = registry[i];
+            registry[i].ptr = NULL;
+            registry_count--;
+            PlaceBlock(block);
+        }
+    }
+}
+
+void BeginAllocationGuard(AllocationGuard *guard) {
+    guard->previous = current_guard;
+    guard->first = next_block_number;
+    current_guard = guard;
+}
+
+void EndAllocationGuard(AllocationGuard *guard) {
+    current_guard = guard->previous;
+    if (current_guard == NULL)
+        FreeRegistry();
+}
+
+_Noreturn void AllocationFailed(void) {
+    AllocationGuard *guard = current_guard;
+    if (guard == NULL)
+        exit(1);
+    ReleaseBlocks(guard->first);
+    EndAllocationGuard(guard);
+    longjmp(guard->handler, 1);
+}
+
+MemoryBudget *SetMemoryBudget(MemoryBudget *budget) {
+    MemoryBudget *previous = memory_budget;
+    memory_budget = budget;
+    return previous;
+}
+
+const MemoryBudget *GetMemoryBudget(void) {
+    return memory_budget;
+}
+
+/**
+ * Sprawdza, czy zmiana rozmiaru pamięci zmieści się w budżecie bieżącego
+ * wątku, i jeśli nie, wywołuje AllocationFailed przed alokacją.
+ * @param[in] old_bytes : poprzedni rozmiar
+ * @param[in] new_bytes : nowy rozmiar
+ */
+static void CheckBudget(size_t old_bytes, size_t new_bytes) {
+    if (memory_budget == NULL || new_bytes <= old_bytes)
+        return;
+    long long available = memory_budget->limit - memory_budget->live_bytes;
+    if (available < 0 ||
+        new_bytes - old_bytes > (unsigned long long) available) {
+        AllocationFailed();
+    }
+}
+
 size_t MultiplySize(size_t x) {
     return 1 + RESIZE_FACTOR * x;
 }
 
 void SafeMonoMalloc(Mono *monos[], size_t size) {
+    CheckBudget(0, size * sizeof(Mono));
     *monos = malloc(size * sizeof(Mono));
     if (*monos == NULL) {
-        exit(1);
+        AllocationFailed();
     }
+    RegisterBlock(*monos, size * sizeof(Mono));
+    mono_counters.allocs++;
+    mono_counters.bytes += size * sizeof(Mono);
+    TrackAlloc(size * sizeof(Mono));
 }
 
-void SafeMonoRealloc(Mono *monos[], size_t size) {
-    *monos = realloc(*monos, size * sizeof(Mono));
-    if (*monos == NULL) {
-        exit(1);
+void SafeMonoRealloc(Mono *monos[], size_t old_size, size_t size) {
+    CheckBudget(old_size * sizeof(Mono), size * sizeof(Mono));
+    Mono *resized = realloc(*monos, size * sizeof(Mono));
+    if (resized == NULL) {
+        AllocationFailed();
+    }
+    MoveBlock(*monos, resized, size * sizeof(Mono));
+    *monos = resized;
+    mono_counters.allocs++;
+    mono_counters.bytes += size * sizeof(Mono);
+    if (old_size == 0) {
+        TrackAlloc(size * sizeof(Mono));
+    } else {
+        TrackRealloc(old_size * sizeof(Mono), size * sizeof(Mono));
+    }
+}
+
+void MonoArrayFree(Mono monos[], size_t size) {
+    if (monos != NULL) {
+        ForgetBlock(monos);
+        TrackFree(size * sizeof(Mono));
+        free(monos);
+    }
+}
+
+void *SafeBytesMalloc(size_t bytes) {
+    CheckBudget(0, bytes);
+    void *ptr = malloc(bytes);
+    if (ptr == NULL) {
+        AllocationFailed();
+    }
+    RegisterBlock(ptr, bytes);
+    TrackAlloc(bytes);
+    return ptr;
+}
+
+void BytesFree(void *ptr, size_t bytes) {
+    if (ptr != NULL) {
+        ForgetBlock(ptr);
+        TrackFree(bytes);
+        free(ptr);
     }
 }
 
 void SafeStackMalloc(PolyStack *stack) {
+    CheckBudget(0, stack->capacity * sizeof(Poly));
     stack->polys = malloc(stack->capacity * sizeof(Poly));
     if (stack->polys == NULL) {
-        exit(1);
+        AllocationFailed();
     }
+    RegisterBlock(stack->polys, stack->capacity * sizeof(Poly));
+    TrackAlloc(stack->capacity * sizeof(Poly));
 }
 
 void SafeStackRealloc(PolyStack *stack) {
-    stack->capacity = MultiplySize(stack->capacity);
-    stack->polys = realloc(stack->polys, stack->capacity * sizeof(Poly));
-    if (stack->polys == NULL) {
-        exit(1);
+    size_t capacity = MultiplySize(stack->capacity);
+    CheckBudget(stack->capacity * sizeof(Poly), capacity * sizeof(Poly));
+    Poly *polys = realloc(stack->polys, capacity * sizeof(Poly));
+    if (polys == NULL) {
+        AllocationFailed(); // stos pozostaje nienaruszony
+    }
+    MoveBlock(stack->polys, polys, capacity * sizeof(Poly));
+    TrackRealloc(stack->capacity * sizeof(Poly), capacity * sizeof(Poly));
+    stack->polys = polys;
+    stack->capacity = capacity;
+}
+
+void StackArrayFree(PolyStack *stack) {
+    if (stack->polys != NULL) {
+        ForgetBlock(stack->polys);
+        TrackFree(stack->capacity * sizeof(Poly));
+        free(stack->polys);
+        stack->polys = NULL;
+    }
+}
+
+void SafeStringMalloc(StringWithSize *str) {
+    CheckBudget(0, str->size * sizeof(*(str->A)));
+    str->A = malloc(str->size * sizeof(*(str->A)));
+    if (str->A == NULL) {
+        AllocationFailed();
+    }
+    RegisterBlock(str->A, str->size * sizeof(*(str->A)));
+    TrackAlloc(str->size * sizeof(*(str->A)));
+}
+
+void SafeStringRealloc(StringWithSize *str, size_t size) {
+    size_t old_size = str->A == NULL ? 0 : str->size;
+    CheckBudget(old_size * sizeof(*(str->A)), size * sizeof(*(str->A)));
+    char *resized = realloc(str->A, size * sizeof(*(str->A)));
+    if (resized == NULL) {
+        AllocationFailed(); // napis pozostaje nienaruszony
+    }
+    MoveBlock(str->A, resized, size * sizeof(*(str->A)));
+    str->A = resized;
+    str->size = size;
+    if (old_size == 0) {
+        TrackAlloc(str->size * sizeof(*(str->A)));
+    } else {
+        TrackRealloc(old_size * sizeof(*(str->A)),
+                     str->size * sizeof(*(str->A)));
+    }
+}
+
+void StringFree(StringWithSize *str) {
+    if (str->A != NULL) {
+        ForgetBlock(str->A);
+        TrackFree(str->size * sizeof(*(str->A)));
+        free(str->A);
+        str->A = NULL;
     }
 }
 
 void ReallocStringIfNecessary(StringWithSize *str) {
-    if (str->length == (int)str->size) {
-        str->size = MultiplySize(str->size);
-        str->A = realloc(str->A, (str->size) * sizeof(*(str->A)));
-        if (str->A == NULL) {
-            exit(1);
-        }
+    if (str->length + 1 >= str->size) {
+        SafeStringRealloc(str, MultiplySize(str->size));
     }
-}
\ No newline at end of file
+}
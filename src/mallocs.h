@@ -8,6 +8,7 @@
 #ifndef MALLOCS_H
 #define MALLOCS_H
 
+#include <setjmp.h>
 #include "poly.h"
 #include "input_output.h"
 #include "stack.h"
@@ -17,6 +18,117 @@
  */
 #define RESIZE_FACTOR 2
 
+/**
+ * To jest struktura przechowująca liczniki alokacji tablic jednomianów
+ * wykonanych przez bieżący wątek.
+ */
+typedef struct MonoAllocCounters {
+    unsigned long long allocs; ///< liczba wywołań malloc i realloc
+    unsigned long long bytes; ///< łączna liczba żądanych bajtów
+} MonoAllocCounters;
+
+/**
+ * Zwraca liczniki alokacji tablic jednomianów wykonanych przez bieżący wątek
+ * od początku jego działania.
+ * @return liczniki
+ */
+MonoAllocCounters GetMonoAllocCounters(void);
+
+/**
+ * Dolicza do liczników bieżącego wątku alokacje wykonane w jego imieniu
+ * przez inny wątek.
+ * @param[in] counters : liczniki alokacji innego wątku
+ */
+void AddMonoAllocCounters(MonoAllocCounters counters);
+
+/**
+ * To jest struktura przechowująca globalne liczniki pamięci zaalokowanej
+ * na tablice jednomianów, stosy i napisy (przez wszystkie wątki).
+ */
+typedef struct MemoryStats {
+    long long live_bytes; ///< liczba bajtów aktualnie zaalokowanych
+    long long peak_bytes; ///< największa dotychczasowa wartość live_bytes
+    unsigned long long allocs; ///< liczba alokacji
+    unsigned long long reallocs; ///< liczba realokacji
+    unsigned long long frees; ///< liczba zwolnień
+} MemoryStats;
+
+/**
+ * Zwraca globalne liczniki pamięci.
+ * Tablica jednomianów przekazana do PolyOwnMonos, która nie została
+ * zaalokowana funkcją SafeMonoMalloc, nie jest doliczana do live_bytes,
+ * choć jej zwolnienie jest odliczane.
+ * @return liczniki
+ */
+MemoryStats GetMemoryStats(void);
+
+/**
+ * Ustawia największe zużycie pamięci na aktualne zużycie.
+ */
+void ResetPeakMemory(void);
+
+/**
+ * To jest struktura przechowująca budżet pamięci, np. jednej sesji serwera.
+ */
+typedef struct MemoryBudget {
+    long long live_bytes; ///< liczba bajtów zaalokowanych w ramach budżetu
+    long long limit; ///< maksymalna liczba bajtów
+} MemoryBudget;
+
+/**
+ * Ustawia budżet pamięci bieżącego wątku. Alokacja, która przekroczyłaby
+ * limit budżetu, kończy się jak nieudana alokacja (AllocationFailed).
+ * Do budżetu doliczane są alokacje i zwolnienia wykonane przez bieżący
+ * wątek, więc cała pamięć z budżetu powinna być alokowana i zwalniana
+ * przez jeden wątek.
+ * @param[in] budget : budżet lub NULL, jeśli alokacje nie są ograniczone
+ * @return poprzedni budżet
+ */
+MemoryBudget *SetMemoryBudget(MemoryBudget *budget);
+
+/**
+ * Zwraca budżet pamięci bieżącego wątku.
+ * @return budżet lub NULL, jeśli alokacje nie są ograniczone
+ */
+const MemoryBudget *GetMemoryBudget(void);
+
+/**
+ * To jest struktura opisująca obszar, z którego nieudana alokacja wraca
+ * do punktu powrotu zamiast kończyć program. Pamięć zaalokowana przez
+ * bieżący wątek w obszarze jest w nim rejestrowana, więc po nieudanej
+ * alokacji zwalniane jest wszystko, co przerwana operacja zaalokowała
+ * i czego jeszcze nie zwolniła. Obszary można zagnieżdżać.
+ */
+typedef struct AllocationGuard {
+    jmp_buf handler; ///< punkt powrotu, ustawiany funkcją setjmp
+    struct AllocationGuard *previous; ///< obszar zewnętrzny lub NULL
+    unsigned long long first; ///< nr pierwszej alokacji w obszarze
+} AllocationGuard;
+
+/**
+ * Rozpoczyna obszar bieżącego wątku. Zaraz potem wołający musi ustawić
+ * punkt powrotu: <tt>if (setjmp(guard->handler) != 0)</tt>. Po powrocie
+ * obszar jest już zakończony, a pamięć zaalokowana w nim zwolniona.
+ * Pamięć zaalokowana w obszarze nie może więc trafić do struktur, które
+ * przetrwają nieudaną alokację.
+ * @param[in,out] guard : obszar
+ */
+void BeginAllocationGuard(AllocationGuard *guard);
+
+/**
+ * Kończy obszar bez nieudanej alokacji. Zaalokowana w nim pamięć należy
+ * odtąd do wołającego (a w obszarze zewnętrznym - do tamtego obszaru).
+ * @param[in,out] guard : ostatnio rozpoczęty obszar bieżącego wątku
+ */
+void EndAllocationGuard(AllocationGuard *guard);
+
+/**
+ * Obsługuje nieudaną alokację: zwalnia pamięć zaalokowaną w ostatnio
+ * rozpoczętym obszarze bieżącego wątku, kończy go i wraca do jego punktu
+ * powrotu, a jeśli obszaru nie ma, kończy program z kodem 1.
+ */
+_Noreturn void AllocationFailed(void);
+
 /**
  * Zwraca liczbę RESIZE_FACTOR razy większą
  * @param x : liczba (rozmiar)
@@ -26,7 +138,7 @@ size_t MultiplySize(size_t x);
 
 /**
  * Alokuje pamięć na tablicę jednomianów.
- * W przypadku błędu funkcji malloc, kończy wykonywanie programu z kodem 1.
+ * W przypadku błędu funkcji malloc wywołuje AllocationFailed.
  * @param[in] monos : tablica jednomianów
  * @param[in] size : na ile elementów chcemy zaalokować pamięć
  */
@@ -34,29 +146,83 @@ void SafeMonoMalloc(Mono *monos[], size_t size);
 
 /**
  * Zmienia rozmiar pamięci przeznaczonej na tablicę jednomianów.
- * W przypadku błędu funkcji realloc, kończy wykonywanie programu z kodem 1.
+ * W przypadku błędu funkcji realloc wywołuje AllocationFailed.
  * @param[in] monos : tablica jednomianów
+ * @param[in] old_size : na ile elementów pamięć jest zaalokowana
  * @param[in] size : na ile elementów chcemy realokować pamięć
  */
-void SafeMonoRealloc(Mono *monos[], size_t size);
+void SafeMonoRealloc(Mono *monos[], size_t old_size, size_t size);
+
+/**
+ * Zwalnia pamięć przeznaczoną na tablicę jednomianów
+ * (bez usuwania samych jednomianów).
+ * @param[in] monos : tablica jednomianów
+ * @param[in] size : na ile elementów pamięć jest zaalokowana
+ */
+void MonoArrayFree(Mono monos[], size_t size);
+
+/**
+ * Alokuje pamięć na obiekt o podanym rozmiarze (np. dużą liczbę),
+ * uwzględniając ją w licznikach i budżecie pamięci.
+ * W przypadku błędu funkcji malloc wywołuje AllocationFailed.
+ * @param[in] bytes : rozmiar obiektu
+ * @return zaalokowana pamięć
+ */
+void *SafeBytesMalloc(size_t bytes);
+
+/**
+ * Zwalnia pamięć zaalokowaną funkcją SafeBytesMalloc.
+ * @param[in] ptr : zaalokowana pamięć
+ * @param[in] bytes : rozmiar obiektu
+ */
+void BytesFree(void *ptr, size_t bytes);
 
 /**
  * Alokuje pamięć na stos wielomianów.
- * W przypadku błędu funkcji malloc, kończy wykonywanie programu z kodem 1.
+ * W przypadku błędu funkcji malloc wywołuje AllocationFailed.
  * @param[in] stack : stos
  */
 void SafeStackMalloc(PolyStack *stack);
 
 /**
  * Zmienia rozmiar pamięci przeznaczonej na stos wielomianów.
- * W przypadku błędu funkcji realloc, kończy wykonywanie programu z kodem 1.
+ * W przypadku błędu funkcji realloc wywołuje AllocationFailed.
  * @param[in] stack : stos
  */
 void SafeStackRealloc(PolyStack *stack);
 
+/**
+ * Zwalnia pamięć przeznaczoną na stos wielomianów
+ * (bez usuwania samych wielomianów).
+ * @param[in,out] stack : stos
+ */
+void StackArrayFree(PolyStack *stack);
+
+/**
+ * Alokuje pamięć na napis, na tyle znaków, ile wskazuje jego rozmiar.
+ * W przypadku błędu funkcji malloc wywołuje AllocationFailed.
+ * @param[in,out] str : napis
+ */
+void SafeStringMalloc(StringWithSize *str);
+
 /**
  * Zmienia rozmiar pamięci przeznaczonej na napis.
- * W przypadku błędu funkcji realloc, kończy wykonywanie programu z kodem 1.
+ * W przypadku błędu funkcji realloc wywołuje AllocationFailed.
+ * @param[in,out] str : napis
+ * @param[in] size : na ile znaków chcemy realokować pamięć
+ */
+void SafeStringRealloc(StringWithSize *str, size_t size);
+
+/**
+ * Zwalnia pamięć przeznaczoną na napis.
+ * @param[in,out] str : napis
+ */
+void StringFree(StringWithSize *str);
+
+/**
+ * Zwiększa rozmiar pamięci przeznaczonej na napis, jeśli poza jego
+ * zawartością nie mieści się w niej więcej niż jeden znak.
+ * W przypadku błędu funkcji realloc wywołuje AllocationFailed.
  * @param str : napis
  */
 void ReallocStringIfNecessary(StringWithSize *str);
@@ -0,0 +1,40 @@
+/** @file
+  Implementacja wspólnych narzędzi pomiarów.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <time.h>
+#include "measure.h"
+
+long long NowNs(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void *FindKind(KindTable *table, const char *name) {
+    for (size_t i = 0; i < table->count; i++) {
+        const char **kind = KindAt(table, i);
+        if (*kind == name || strcmp(*kind, name) == 0)
+            return kind;
+    }
+    if (table->count == MEASURE_MAX_KINDS)
+        return NULL;
+    const char **kind = KindAt(table, table->count++);
+    memset(kind, 0, table->entry_size);
+    *kind = name;
+    return kind;
+}
+
+void PrintKindHeader(FILE *out) {
+    fprintf(out, "%-12s %10s", "command", "count");
+}
+
+void PrintKindLabel(FILE *out, const char *name, unsigned long long count) {
+    fprintf(out, "%-12s %10llu", name, count);
+}
@@ -0,0 +1,71 @@
+/** @file
+  Wspólne narzędzia pomiarów kalkulatora (tryby --stats, --perf i --trace)
+  i benchmarków: zegar i tabela sum pomiarów rodzajów poleceń.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#ifndef MEASURE_H
+#define MEASURE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Maksymalna liczba rodzajów poleceń w tabeli.
+ */
+#define MEASURE_MAX_KINDS 32
+
+/**
+ * To jest struktura opisująca tabelę sum pomiarów rodzajów poleceń,
+ * w kolejności pierwszego wystąpienia. Pierwszym polem każdego wpisu
+ * musi być nazwa polecenia (const char *).
+ */
+typedef struct KindTable {
+    void *entries; ///< tablica MEASURE_MAX_KINDS wpisów
+    size_t entry_size; ///< rozmiar wpisu w bajtach
+    size_t count; ///< liczba rodzajów poleceń
+} KindTable;
+
+/**
+ * Zwraca aktualny czas w nanosekundach (zegar monotoniczny).
+ * @return czas
+ */
+long long NowNs(void);
+
+/**
+ * Wyszukuje wpis rodzaju poleceń, tworząc w razie potrzeby nowy,
+ * wyzerowany wpis o podanej nazwie.
+ * @param[in,out] table : tabela
+ * @param[in] name : nazwa polecenia
+ * @return wpis lub NULL, jeśli zabrakło miejsca
+ */
+void *FindKind(KindTable *table, const char *name);
+
+/**
+ * Zwraca wpis tabeli o podanym numerze.
+ * @param[in] table : tabela
+ * @param[in] i : numer wpisu, mniejszy niż table->count
+ * @return wpis
+ */
+static inline void *KindAt(const KindTable *table, size_t i) {
+    return (char *) table->entries + i * table->entry_size;
+}
+
+/**
+ * Wypisuje początek nagłówka tabeli: kolumny nazwy polecenia i liczby
+ * wykonań.
+ * @param[in] out : plik
+ */
+void PrintKindHeader(FILE *out);
+
+/**
+ * Wypisuje początek wiersza tabeli: nazwę polecenia i liczbę wykonań.
+ * @param[in] out : plik
+ * @param[in] name : nazwa polecenia
+ * @param[in] count : liczba wykonań
+ */
+void PrintKindLabel(FILE *out, const char *name, unsigned long long count);
+
+#endif //MEASURE_H
@@ -1,466 +1,426 @@
 /** @file
-  Implementacja funkcji parsujących wielomiany i komendy kalkulatora.
+  Implementacja funkcji parsujących wielomiany.
 
   @author Michał Napiórkowski
   @date 2021
 */
 
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include <assert.h>
-#include <errno.h>
 #include <limits.h>
-#include <string.h>
-#include <stdio.h>
+#include <pthread.h>
 #include "stack.h"
 #include "parsing.h"
 #include "mallocs.h"
 #include "input_output.h"
+#include "trace.h"
 
 /**
- * Sprawdza, czy nie został przekroczony zakres danego typu
- * przy parsowaniu funkcjami strto*.
- * @return czy zakres został przekroczony?
+ * Zwraca znak napisu na pozycji @p i lub '\0', jeśli @p i wychodzi poza
+ * sprawdzany fragment.
+ * @param[in] str : napis
+ * @param[in] i : indeks
+ * @param[in] end : indeks końca fragmentu (wyłącznie)
+ * @return znak
  */
-static bool IsInRange() {
-    if (errno == ERANGE) {
-        errno = 0;
+static inline char CharAt(StringWithSize str, size_t i, size_t end) {
+    return i < end ? str.A[i] : '\0';
+}
+
+/**
+ * Kończy parsowanie współczynnika, którego zapis nie mieści się w typie
+ * poly_coeff_word_t. Taki współczynnik jest poprawny tylko w wariancie
+ * POLY_COEFF_BIG (zob. coeff.h).
+ * @param[in] str : napis
+ * @param[in] first_digit : indeks pierwszej cyfry
+ * @param[in,out] i : aktualny indeks, po wyjściu - pierwszy znak za liczbą
+ * @param[in] end : indeks końca fragmentu (wyłącznie)
+ * @param[in] negative : czy liczba jest ujemna
+ * @param[out] coeff : sparsowany współczynnik
+ * @param[out] in_range : czy liczba mieści się w zakresie typu
+ * @return czy napis zaczyna się od poprawnego współczynnika
+ */
+static bool ParseLongCoeff(StringWithSize str, size_t first_digit, size_t *i,
+                           size_t end, bool negative, poly_coeff_t *coeff,
+                           bool *in_range) {
+    while (IsDigit(CharAt(str, *i, end))) {
+        (*i)++;
+    }
+    if (!CoeffFromDigits(str.A + first_digit, *i - first_digit, negative,
+                         coeff)) {
+        *in_range = false;
         return false;
     }
     return true;
 }
 
-bool StringIsCoeff(StringWithSize str, int begin, int end) {
-    int i = begin;
-    if ((end - begin > 1 && str.A[i] == '-' &&
-        (str.A[i + 1] >= '0' && str.A[i + 1] <= '9')) ||
-        (str.A[i] >= '0' && str.A[i] <= '9')) {
+/**
+ * Parsuje współczynnik zaczynający się na pozycji @p *i.
+ * Cyfry akumulujemy jako liczbę ujemną, żeby poprawnie sparsować
+ * najmniejszą wartość typu. W wariancie modularnym liczba jest
+ * sprowadzana do reszty.
+ * @param[in] str : napis
+ * @param[in,out] i : aktualny indeks, po wyjściu - pierwszy znak za liczbą
+ * @param[in] end : indeks końca fragmentu (wyłącznie)
+ * @param[out] coeff : sparsowany współczynnik
+ * @param[out] in_range : czy liczba mieści się w zakresie typu
+ * @return czy napis zaczyna się od poprawnego współczynnika
+ */
+static bool ParseCoeff(StringWithSize str, size_t *i, size_t end,
+                       poly_coeff_t *coeff, bool *in_range) {
+    bool negative = CharAt(str, *i, end) == '-';
+    if (negative) {
+        (*i)++;
+    }
+    if (!IsDigit(CharAt(str, *i, end))) {
+        return false;
+    }
 
-        i++;
-        while (i < end) {
-            if (str.A[i] >= '0' && str.A[i] <= '9')
-                i++;
-            else
-                return false;
+    size_t first_digit = *i;
+    poly_coeff_word_t value = 0;
+    while (IsDigit(CharAt(str, *i, end))) {
+        int digit = str.A[*i] - '0';
+        if (value < (POLY_COEFF_MIN + digit) / 10) {
+            return ParseLongCoeff(str, first_digit, i, end, negative, coeff,
+                                  in_range);
         }
-    } else {
-        return false;
+        value = value * 10 - digit;
+        (*i)++;
+    }
+    if (!negative) {
+        if (value == POLY_COEFF_MIN) {
+            return ParseLongCoeff(str, first_digit, i, end, negative, coeff,
+                                  in_range);
+        }
+        value = -value;
     }
+    *coeff = CoeffFromWord(value);
     return true;
 }
 
-poly_coeff_t CoeffFromString(StringWithSize str, int begin, bool *in_range) {
-    poly_coeff_t coeff = strtol(&str.A[begin], NULL, 10);
-    *in_range = IsInRange();
-    return coeff;
+bool CoeffFromString(StringWithSize str, size_t begin, size_t end,
+                     poly_coeff_t *coeff) {
+    bool in_range = true;
+    size_t i = begin;
+    if (!ParseCoeff(str, &i, end, coeff, &in_range))
+        return false;
+    if (i != end) {
+        CoeffDestroy(*coeff);
+        return false;
+    }
+    return true;
 }
 
 /**
- * Zlicza znaki '+' występujące w napisie reprezentującym wielomian.
- * Bierze pod uwagę tylko te, które poprzedza poprawne wyrażenie nawiasowe.
- * @param[in] str : napis reprezentujący wielomian
- * @param[in] begin : indeks początkowy (włącznie)
- * @param[in] end : indeks końcowy (wyłącznie)
- * @return liczba plusów
+ * Parsuje wykładnik zaczynający się na pozycji @p *i.
+ * @param[in] str : napis
+ * @param[in,out] i : aktualny indeks, po wyjściu - pierwszy znak za liczbą
+ * @param[in] end : indeks końca fragmentu (wyłącznie)
+ * @param[out] exp : sparsowany wykładnik
+ * @param[out] in_range : czy liczba mieści się w zakresie typu
+ * @return czy napis zaczyna się od poprawnego wykładnika
  */
-static int CountPluses(StringWithSize str, int begin, int end) {
-    int count = 0, open_br = 0, close_br = 0;
-    for (int i = begin; i < end; i++) {
-        if (str.A[i] == '+' && open_br == close_br) {
-            count++;
-        } else if (str.A[i] == '(') {
-            open_br++;
-        } else if (str.A[i] == ')') {
-            close_br++;
+static bool ParseExp(StringWithSize str, size_t *i, size_t end,
+                     poly_exp_t *exp, bool *in_range) {
+    if (!IsDigit(CharAt(str, *i, end))) {
+        return false;
+    }
+
+    poly_exp_t value = 0;
+    while (IsDigit(CharAt(str, *i, end))) {
+        int digit = str.A[*i] - '0';
+        if (value > (INT_MAX - digit) / 10) {
+            *in_range = false;
+            return false;
         }
+        value = value * 10 + digit;
+        (*i)++;
     }
-    return count;
+    *exp = value;
+    return true;
 }
 
 /**
- * Zlicza nawiasy otwierające i zamykające w napisie
- * oraz sprawdza indeks przecinka.
+ * Sprawdza, czy na pozycji @p *i znajduje się oczekiwany znak,
+ * i jeśli tak, przesuwa indeks za niego.
+ * @param[in] str : napis
  * @param[in,out] i : aktualny indeks
- * @param[in] end : indeks, do którego sprawdzamy
- * @param[in] A : tablica znaków, którą sprawdzamy
- * @param[out] comma : indeks, pod którym występuje przecinek
- * @param[out] open_br : liczba nawiasów otwierających
- * @param[out] close_br : liczba nawiasów zamykających
+ * @param[in] end : indeks końca fragmentu (wyłącznie)
+ * @param[in] expected : oczekiwany znak
+ * @return czy znak był zgodny z oczekiwanym
  */
-static void CountBrackets(int *i, int end, char A[],
-                          int *comma, int *open_br, int *close_br) {
-    while (*i < end && !(A[*i] == '+' && *open_br == *close_br)) {
-        // przerywamy na '+' jeśli zgadzają się nawiasy
-        if (A[*i] == ',') {
-            *comma = *i;
-        } else if (A[*i] == '(') {
-            (*open_br)++;
-        } else if (A[*i] == ')') {
-            (*close_br)++;
-        }
-        (*i)++;
+static bool ParseChar(StringWithSize str, size_t *i, size_t end, char expected) {
+    if (CharAt(str, *i, end) != expected) {
+        return false;
     }
+    (*i)++;
+    return true;
 }
 
-Poly PolyFromString(StringWithSize str, int begin, int end,
-                    bool *correct, bool *in_range) {
-    Poly result;
-    Mono *monos;
-    int index = 0;
-    int i = begin;
-    int new_begin = begin + 1;
-    int comma = -1;
-    int open_br = 0;
-    int close_br = 0;
-    char *endptr;
-    *correct = true;
-    *in_range = true;
-
-    if (str.A[begin] != '(' || str.A[end - 1] != ')') {
-        *correct = false;
+/**
+ * Usuwa jednomiany z tablicy i zwalnia jej pamięć.
+ * @param[in] count : liczba jednomianów
+ * @param[in] capacity : na ile jednomianów zaalokowana jest tablica
+ * @param[in] monos : tablica jednomianów
+ */
+static void DestroyMonos(size_t count, size_t capacity, Mono monos[]) {
+    for (size_t j = 0; j < count; j++) {
+        MonoDestroy(&monos[j]);
     }
+    MonoArrayFree(monos, capacity);
+}
 
-    int pluses = CountPluses(str, begin, end);
-    SafeMonoMalloc(&monos, (size_t)(pluses + 1));
-
-    while (i < end) {
-        CountBrackets(&i, end, str.A, &comma, &open_br, &close_br);
-
-        if (comma < 0) {
-            *correct = false;
-        }
-        // teraz i jest na '+' albo na '\n' kończącym stringa
-        // albo na ',' jeśli jesteśmy wewnątrz rekurencji
-        // comma to indeks pod którym jest ostatni przecinek w danym jednomianie
-        if (comma + 1 == i - 1) { // jest coś takiego (xyz,)
-            *correct = false;
+/**
+ * Parsuje wielomian zaczynający się na pozycji @p *i w jednym przebiegu
+ * od lewej do prawej. Jednomiany są od razu zbierane do tablicy,
+ * a współczynniki będące wielomianami parsowane są rekurencyjnie
+ * bez ponownego przeglądania ich napisu.
+ * @param[in] str : napis
+ * @param[in,out] i : aktualny indeks, po wyjściu - pierwszy znak za wielomianem
+ * @param[in] end : indeks końca fragmentu (wyłącznie)
+ * @param[out] result : sparsowany wielomian
+ * @param[out] in_range : czy liczby mieszczą się w zakresach
+ * @return czy napis zaczyna się od poprawnego wielomianu
+ */
+static bool ParsePoly(StringWithSize str, size_t *i, size_t end,
+                      Poly *result, bool *in_range) {
+    if (CharAt(str, *i, end) != '(') {
+        poly_coeff_t coeff;
+        if (!ParseCoeff(str, i, end, &coeff, in_range)) {
+            return false;
         }
+        *result = PolyFromCoeff(coeff);
+        return true;
+    }
 
-        for (int j = comma + 1; j < i - 1; j++) {
-            if (str.A[j] < '0' || str.A[j] > '9') {
-                *correct = false;
-            }
+    Mono *monos = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    do {
+        Poly p;
+        poly_exp_t exp;
+        if (!ParseChar(str, i, end, '(') ||
+            !ParsePoly(str, i, end, &p, in_range)) {
+            DestroyMonos(count, capacity, monos);
+            return false;
         }
-
-        if (*correct == false) {
-            MonosArrayDestroy(index, monos);
-            return PolyZero();
+        if (!ParseChar(str, i, end, ',') ||
+            !ParseExp(str, i, end, &exp, in_range) ||
+            !ParseChar(str, i, end, ')')) {
+            PolyDestroy(&p);
+            DestroyMonos(count, capacity, monos);
+            return false;
         }
 
-        int exp = strtol(&str.A[comma + 1], &endptr, 10);
-        if (!IsInRange() || exp > INT_MAX || exp < 0) {
-            *in_range = false;
-            MonosArrayDestroy(index, monos);
-            return PolyZero();
+        if (PolyIsZero(&p)) {
+            continue; // zerowy jednomian nie wnosi nic do sumy
         }
-
-        Poly p;
-        if (StringIsCoeff(str, new_begin, comma)) {
-            poly_coeff_t coeff = CoeffFromString(str, new_begin, in_range);
-            if (*in_range) {
-                p = PolyFromCoeff(coeff);
-            }
-        } else {
-            p = PolyFromString(str, new_begin, comma, correct, in_range);
-        }
-
-        if (*correct == false || *in_range == false) {
-            MonosArrayDestroy(index, monos);
-            return PolyZero();
+        if (count == capacity) {
+            capacity = MultiplySize(capacity);
+            SafeMonoRealloc(&monos, count, capacity);
         }
+        monos[count] = MonoFromPoly(&p, exp);
+        count++;
+    } while (ParseChar(str, i, end, '+'));
 
-        Mono m = MonoFromPoly(&p, exp);
-        monos[index] = m;
-        index++;
-        i++;
-        new_begin = i + 1;
+    if (count < capacity && count > 0) {
+        // wielomian przechowuje tablicę dokładnie na swoje jednomiany
+        SafeMonoRealloc(&monos, capacity, count);
     }
-
-    result = PolyAddMonos(index, monos);
-    free(monos);
-    return result;
+    *result = PolyOwnMonos(count, monos);
+    return true;
 }
 
 /**
- * Wypisuje odpowiedni błąd jeśli stos jest pusty.
- * @param[in] empty : czy stos jest pusty
- * @param[in] line : aktualny nr wiersza
- * @return czy stos jest pusty?
+ * Parsuje wielomian zajmujący cały fragment napisu w bieżącym wątku.
+ * @param[in] str : napis
+ * @param[in] begin : indeks początkowy
+ * @param[in] end : indeks końcowy
+ * @param[out] correct : czy wielomian jest poprawny
+ * @param[out] in_range : czy liczby mieszczą się w zakresach
+ * @return wielomian
  */
-static bool TopIsEmpty(bool empty, int line) {
-    if (empty) {
-        PrintError(line, "STACK UNDERFLOW");
-        return true;
-    }
-    return false;
-}
-
-void WordIsCommand(char word[], int line, PolyStack *stack) {
-    bool empty;
+static Poly ParseWhole(StringWithSize str, size_t begin, size_t end,
+                       bool *correct, bool *in_range) {
+    Poly result = PolyZero();
+    size_t i = begin;
+    *in_range = true;
+    *correct = ParsePoly(str, &i, end, &result, in_range) && i == end;
 
-    if (strcmp(word, "ZERO") == 0) {
-        StackPush(stack, PolyZero());
-    } else if (strcmp(word, "IS_COEFF") == 0) {
-        Poly top = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line))
-            return;
-        PrintInt((int) PolyIsCoeff(&top));
-    } else if (strcmp(word, "IS_ZERO") == 0) {
-        Poly top = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line))
-            return;
-        PrintInt((int) PolyIsZero(&top));
-    } else if (strcmp(word, "CLONE") == 0) {
-        Poly top = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line))
-            return;
-        Poly clone = PolyClone(&top);
-        StackPush(stack, clone);
-    } else if (strcmp(word, "ADD") == 0) {
-        Poly p = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line))
-            return;
-        StackPop(stack);
-        Poly q = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line)) {
-            (stack->top)++;
-            return;
-        }
-        StackPop(stack);
-        Poly sum = PolyAdd(&p, &q);
-        PolyDestroy(&p);
-        PolyDestroy(&q);
-        StackPush(stack, sum);
-    } else if (strcmp(word, "MUL") == 0) {
-        Poly p = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line))
-            return;
-        StackPop(stack);
-        Poly q = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line)) {
-            (stack->top)++;
-            return;
-        }
-        StackPop(stack);
-        Poly mul = PolyMul(&p, &q);
-        PolyDestroy(&p);
-        PolyDestroy(&q);
-        StackPush(stack, mul);
-    } else if (strcmp(word, "NEG") == 0) {
-        Poly top = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line))
-            return;
-        StackPop(stack);
-        Poly neg = PolyNeg(&top);
-        PolyDestroy(&top);
-        StackPush(stack, neg);
-    } else if (strcmp(word, "SUB") == 0) {
-        Poly p = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line))
-            return;
-        StackPop(stack);
-        Poly q = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line)) {
-            (stack->top)++;
-            return;
-        }
-        StackPop(stack);
-        Poly sub = PolySub(&p, &q);
-        PolyDestroy(&p);
-        PolyDestroy(&q);
-        StackPush(stack, sub);
-    } else if (strcmp(word, "IS_EQ") == 0) {
-        Poly p = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line))
-            return;
-        StackPop(stack);
-        Poly q = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line)) {
-            (stack->top)++;
-            return;
-        }
-        StackPush(stack, p);
-        PrintInt((int) PolyIsEq(&p, &q));
-    } else if (strcmp(word, "DEG") == 0) {
-        Poly top = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line))
-            return;
-        PrintInt(PolyDeg(&top));
-    } else if (strcmp(word, "PRINT") == 0) {
-        Poly top = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line))
-            return;
-        PolyPrint(&top);
-        if (printf("\n") < 0)
-            exit(1);
-    } else if (strcmp(word, "POP") == 0) {
-        Poly top = StackTop(stack, &empty);
-        if (TopIsEmpty(empty, line))
-            return;
-        PolyDestroy(&top);
-        StackPop(stack);
-    } else {
-        PrintError(line, "WRONG COMMAND");
+    if (!*correct || !*in_range) {
+        PolyDestroy(&result);
     }
+    return result;
 }
 
-void WordIsCommandWithArg(StringWithSize str, int *l,
-                          int line, PolyStack *stack) {
-    bool empty;
-    char *endptr;
-
-    if (strcmp(str.A, "DEG_BY") == 0) {
-        (*l)++;
-        if (str.A[*l] >= '0' && str.A[*l] <= '9') {
-            unsigned long index = strtoul(&str.A[*l], &endptr, 10);
-
-            if (!IsInRange() || endptr != &str.A[str.length - 1]) {
-                // błąd bo przekroczono zakres lub są jakieś dalsze znaki
-                PrintError(line, "DEG BY WRONG VARIABLE");
-            } else {
-                Poly top = StackTop(stack, &empty);
-                if (TopIsEmpty(empty, line))
-                    return;
-                PrintInt(PolyDegBy(&top, index));
-            }
-        } else {
-            // błąd bo niedozwolony znak (np więcej niż jedna spacja)
-            PrintError(line, "DEG BY WRONG VARIABLE");
-        }
-    } else if (strcmp(str.A, "AT") == 0) {
-        (*l)++;
-        if ((str.A[*l] >= '0' && str.A[*l] <= '9') || str.A[*l] == '-') {
-            long x = strtol(&str.A[*l], &endptr, 10);
+/** Liczba wątków parsujących jeden wielomian. */
+static long parse_threads = 1;
 
-            if (!IsInRange() || endptr != &str.A[str.length - 1]) {
-                // błąd bo są jakieś dalsze znaki
-                PrintError(line, "AT WRONG VALUE");
-            } else {
-                Poly top = StackTop(stack, &empty);
-                if (TopIsEmpty(empty, line))
-                    return;
-                Poly p = PolyAt(&top, x);
-                PolyDestroy(&top);
-                StackPop(stack);
-                StackPush(stack, p);
-            }
-        } else {
-            // błąd bo niedozwolony znak (np więcej niż jedna spacja)
-            PrintError(line, "AT WRONG VALUE");
-        }
-    } else if (strcmp(str.A, "COMPOSE") == 0) {
-        (*l)++;
-        if (str.A[*l] >= '0' && str.A[*l] <= '9') {
-            unsigned long long k = strtoull(&str.A[*l], &endptr, 10);
-            if (!IsInRange() || endptr != &str.A[str.length - 1]) {
-                // błąd bo przekroczono zakres lub są jakieś dalsze znaki
-                PrintError(line, "COMPOSE WRONG PARAMETER");
-            } else {
-                if (k > stack->capacity) {
-                    PrintError(line, "STACK UNDERFLOW");
-                    return;
-                }
-                Poly p = StackTop(stack, &empty);
-                if (TopIsEmpty(empty, line))
-                    return;
-                StackPop(stack);
+void SetParseThreads(long threads) {
+    if (threads < 1)
+        threads = 1;
+    if (threads > PARSE_MAX_THREADS)
+        threads = PARSE_MAX_THREADS;
+    parse_threads = threads;
+}
 
-                Poly *q = malloc(k * sizeof(Poly));
-                if (q == NULL)
-                    exit(1);
+/**
+ * To jest struktura opisująca ciąg jednomianów parsowany przez jeden wątek.
+ */
+typedef struct ParseChunk {
+    StringWithSize str; ///< napis
+    size_t begin; ///< indeks pierwszego znaku ciągu
+    size_t end; ///< indeks końca ciągu (wyłącznie)
+    Poly result; ///< suma jednomianów ciągu
+    bool correct; ///< czy ciąg jest poprawny
+    bool in_range; ///< czy liczby mieszczą się w zakresach
+    MonoAllocCounters allocs; ///< alokacje wykonane podczas parsowania
+} ParseChunk;
 
-                for (unsigned long long j = 0; j < k; j++) {
-                    q[j] = StackTop(stack, &empty);
-                    if (TopIsEmpty(empty, line)) {
-                        (stack->top) += j + 1;
-                        free(q);
-                        return;
-                    }
-                    StackPop(stack);
-                }
+/**
+ * Funkcja wątku parsującego ciąg jednomianów. Ciąg jednomianów
+ * oddzielonych znakami '+' jest poprawnym zapisem wielomianu.
+ * @param[in,out] arg : ciąg jednomianów
+ * @return NULL
+ */
+static void *ParseChunkThread(void *arg) {
+    ParseChunk *chunk = arg;
+    MonoAllocCounters before = GetMonoAllocCounters();
+    chunk->result = ParseWhole(chunk->str, chunk->begin, chunk->end,
+                               &chunk->correct, &chunk->in_range);
+    MonoAllocCounters after = GetMonoAllocCounters();
+    chunk->allocs.allocs = after.allocs - before.allocs;
+    chunk->allocs.bytes = after.bytes - before.bytes;
+    return NULL;
+}
 
-                Poly composed = PolyCompose(&p, (size_t)k, q);
-                PolyDestroy(&p);
-                for (unsigned long long j = 0; j < k; j++) {
-                    PolyDestroy(&q[j]);
-                }
-                free(q);
-                StackPush(stack, composed);
-            }
-        } else {
-            // błąd bo niedozwolony znak (np więcej niż jedna spacja)
-            PrintError(line, "COMPOSE WRONG PARAMETER");
+/**
+ * Dzieli wielomian na ciągi jednomianów o zbliżonej długości, tnąc go
+ * na znakach '+' poza nawiasami.
+ * @param[in] str : napis
+ * @param[in] begin : indeks początkowy
+ * @param[in] end : indeks końcowy
+ * @param[in] count : liczba ciągów, na które chcemy podzielić wielomian
+ * @param[out] chunks : ciągi jednomianów
+ * @return liczba ciągów (co najwyżej @p count)
+ */
+static size_t SplitMonos(StringWithSize str, size_t begin, size_t end,
+                         size_t count, ParseChunk chunks[]) {
+    size_t found = 0;
+    size_t chunk_begin = begin;
+    size_t target = begin + (end - begin) / count;
+    long depth = 0;
+
+    for (size_t i = begin; i < end && found + 1 < count; i++) {
+        if (str.A[i] == '(') {
+            depth++;
+        } else if (str.A[i] == ')') {
+            depth--;
+        } else if (str.A[i] == '+' && depth == 0 && i >= target) {
+            chunks[found++] = (ParseChunk) {.str = str, .begin = chunk_begin,
+                                            .end = i};
+            chunk_begin = i + 1;
+            target = begin + (end - begin) / count * (found + 1);
         }
-    } else {
-        // błąd bo nieprawidłowe polecenie
-        PrintError(line, "WRONG COMMAND");
     }
+    chunks[found++] = (ParseChunk) {.str = str, .begin = chunk_begin,
+                                    .end = end};
+    return found;
 }
 
-void WordIsPoly(StringWithSize str, int line, PolyStack *stack) {
-    Poly p;
-    bool in_range;
+/**
+ * Łączy sumy ciągów jednomianów w jeden wielomian i zwalnia ich tablice.
+ * Jeśli ciągi zawierają rozłączne, rosnące przedziały wykładników
+ * (np. wielomian wypisany przez PRINT), nie trzeba ich już sortować.
+ * @param[in] count : liczba ciągów
+ * @param[in] chunks : poprawnie sparsowane ciągi jednomianów
+ * @return wielomian
+ */
+static Poly JoinChunks(size_t count, ParseChunk chunks[]) {
+    size_t total = 0;
+    for (size_t k = 0; k < count; k++) {
+        Poly *p = &chunks[k].result;
+        total += PolyIsCoeff(p) ? !PolyIsZero(p) : p->size;
+    }
+    if (total == 0)
+        return PolyZero();
 
-    if (StringIsCoeff(str, 0, str.length - 1)) {
-        poly_coeff_t coeff = CoeffFromString(str, 0, &in_range);
-        if (!in_range) {
-            PrintError(line, "WRONG POLY");
-            return;
-        }
-        p = PolyFromCoeff(coeff);
-        StackPush(stack, p);
-    } else {
-        bool correct;
-        p = PolyFromString(str, 0, str.length - 1, &correct, &in_range);
-        if (correct && in_range) {
-            StackPush(stack, p);
+    Mono *monos;
+    SafeMonoMalloc(&monos, total);
+    size_t n = 0;
+    for (size_t k = 0; k < count; k++) {
+        Poly *p = &chunks[k].result;
+        if (PolyIsCoeff(p)) {
+            if (!PolyIsZero(p))
+                monos[n++] = MonoFromPoly(p, 0);
         } else {
-            PrintError(line, "WRONG POLY");
+            memcpy(monos + n, p->arr, p->size * sizeof(Mono));
+            n += p->size;
+            MonoArrayFree(p->arr, p->size);
         }
     }
+    return PolyOwnMonos(total, monos);
 }
 
-void AnalyzeLine(StringWithSize str, int line, PolyStack *stack) {
-    assert(str.length >= 1);
-    char first = str.A[0];
-
-    if (first == '\n')
-        return;
-
-    if ((first >= 'A' && first <= 'Z') || (first >= 'a' && first <= 'z')) {
-        int l = 1;
-        while (str.A[l] != '\n' && str.A[l] != ' ' &&
-               (str.A[l] < 9 || str.A[l] > 13)) {
-            // dopóki nie natrafimy na znak biały
-            if (str.A[l] == '\0') {
-                PrintError(line, "WRONG COMMAND");
-                return;
-            }
-            l++;
-        }
-        if (str.A[l] == ' ') {
-            // zamieniamy spację po słowie na null char, żeby stringi działały
-            str.A[l] = '\0';
-        } else { // jest innym białym znakiem
-            str.A[l] = '\0';
-            if (strcmp(str.A, "AT") == 0) {
-                PrintError(line, "AT WRONG VALUE");
-                return;
-            } else if (strcmp(str.A, "DEG_BY") == 0) {
-                PrintError(line, "DEG BY WRONG VARIABLE");
-                return;
-            } else if (strcmp(str.A, "COMPOSE") == 0) {
-                PrintError(line, "COMPOSE WRONG PARAMETER");
-                return;
-            }
+/**
+ * Parsuje wielomian, dzieląc go na @p count ciągów jednomianów
+ * parsowanych równolegle. Pierwszy ciąg parsuje bieżący wątek.
+ * @param[in] str : napis
+ * @param[in] begin : indeks początkowy
+ * @param[in] end : indeks końcowy
+ * @param[in] count : liczba wątków
+ * @param[out] correct : czy wielomian jest poprawny
+ * @param[out] in_range : czy liczby mieszczą się w zakresach
+ * @return wielomian
+ */
+static Poly ParallelPolyFromString(StringWithSize str, size_t begin,
+                                   size_t end, size_t count,
+                                   bool *correct, bool *in_range) {
+    ParseChunk chunks[PARSE_MAX_THREADS];
+    pthread_t threads[PARSE_MAX_THREADS];
+    bool started[PARSE_MAX_THREADS] = {false};
+    count = SplitMonos(str, begin, end, count, chunks);
+
+    for (size_t k = 1; k < count; k++) {
+        started[k] = pthread_create(&threads[k], NULL, ParseChunkThread,
+                                    &chunks[k]) == 0;
+    }
+    ParseChunkThread(&chunks[0]);
+    *correct = true;
+    *in_range = true;
+    for (size_t k = 0; k < count; k++) {
+        if (k > 0 && started[k]) {
+            pthread_join(threads[k], NULL);
+        } else if (k > 0) { // nie udało się utworzyć wątku
+            ParseChunkThread(&chunks[k]);
         }
+        AddMonoAllocCounters(chunks[k].allocs);
+        *correct = *correct && chunks[k].correct;
+        *in_range = *in_range && chunks[k].in_range;
+    }
 
-        if (l == str.length - 1) {
-            WordIsCommand(str.A, line, stack);
-        } else {
-            WordIsCommandWithArg(str, &l, line, stack);
+    if (!*correct || !*in_range) {
+        for (size_t k = 0; k < count; k++) {
+            PolyDestroy(&chunks[k].result);
         }
-    } else {
-        WordIsPoly(str, line, stack);
+        return PolyZero();
+    }
+    return JoinChunks(count, chunks);
+}
+
+Poly PolyFromString(StringWithSize str, size_t begin, size_t end,
+                    bool *correct, bool *in_range) {
+    size_t count = (end - begin) / PARSE_CHUNK_LENGTH;
+    if (count > (size_t) parse_threads)
+        count = (size_t) parse_threads;
+    if (count > 1 && CharAt(str, begin, end) == '(') {
+        TraceSpan span = TraceBegin();
+        Poly p = ParallelPolyFromString(str, begin, end, count,
+                                        correct, in_range);
+        TraceEnd(&span, "ParallelPolyFromString", TRACE_PARSE, 0);
+        return p;
     }
-}
\ No newline at end of file
+    return ParseWhole(str, begin, end, correct, in_range);
+}
@@ -1,6 +1,5 @@
 /** @file
-  Funkcje parsujące wielomiany i komendy kalkulatora
-  oraz ich funkcje pomocnicze.
+  Funkcje parsujące wielomiany oraz ich funkcje pomocnicze.
 
   @author Michał Napiórkowski
   @date 2021
@@ -13,68 +12,56 @@
 #include "stack.h"
 
 /**
- * Sprawdza, czy napis reprezentuje współczynnik.
- * @param[in] str : napis
- * @param[in] begin : indeks, od którego znaku sprawdzamy napis (włącznie)
- * @param[in] end : indeks, do którego znaku sprawdzamy napis (wyłącznie)
- * @return Czy napis jest współczynnikiem?
+ * Czy znak jest cyfrą dziesiętną?
+ * @param[in] c : znak
+ * @return czy jest cyfrą
  */
-bool StringIsCoeff(StringWithSize str, int begin, int end);
+static inline bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
 
 /**
- * Parsuje napis reprezentujący współczynnik do tego współczynnika.
- * @param[in] str : napis
- * @param[in] begin : indeks znaku od którego parsujemy
- * @param[out] in_range : czy podczas parsowania został przekroczony zakres typu
- * @return współczynnik
+ * Maksymalna liczba wątków parsujących jeden wielomian.
  */
-poly_coeff_t CoeffFromString(StringWithSize str, int begin, bool *in_range);
+#define PARSE_MAX_THREADS 64
 
 /**
- * Parsuje napis reprezentujący wielomian do tego wielomianu.
- * @param[in] str : napis
- * @param[in] begin : indeks początkowy
- * @param[in] end : indeks końcowy
- * @param[out] correct : czy wielomian jest poprawny
- * @param[out] in_range : czy liczby mieszczą się w zakresach
- * @return wielomian
+ * Minimalna długość fragmentu wielomianu parsowanego przez osobny wątek.
  */
-Poly PolyFromString(StringWithSize str, int begin, int end,
-                    bool *correct, bool *in_range);
+#define PARSE_CHUNK_LENGTH (1 << 20)
 
 /**
- * Sprawdza, czy napis jest poprawną komendą bezargumentową
- * i podejmuje odpowiednie akcje dotyczące stosu.
- * @param[in] word : napis
- * @param[in] line : aktualny nr wiersza
- * @param[in,out] stack : stos
+ * Ustawia liczbę wątków, którymi parsowany jest jeden długi wielomian
+ * (domyślnie 1). Liczba jest przycinana do przedziału [1, PARSE_MAX_THREADS].
+ * @param[in] threads : liczba wątków
  */
-void WordIsCommand(char word[], int line, PolyStack *stack);
+void SetParseThreads(long threads);
 
 /**
- * Sprawdza, czy napis jest poprawną komendą jednoargumentową
- * i podejmuje odpowiednie akcje dotyczące stosu.
+ * Parsuje współczynnik zajmujący cały fragment napisu.
  * @param[in] str : napis
- * @param[in,out] l : indeks następujący zaraz po komendzie
- * @param[in] line : aktualny nr wiersza
- * @param[in,out] stack : stos
+ * @param[in] begin : indeks początkowy
+ * @param[in] end : indeks końcowy
+ * @param[out] coeff : sparsowany współczynnik
+ * @return czy fragment jest poprawnym współczynnikiem z zakresu typu
  */
-void WordIsCommandWithArg(StringWithSize str, int *l, int line, PolyStack *stack);
+bool CoeffFromString(StringWithSize str, size_t begin, size_t end,
+                     poly_coeff_t *coeff);
 
 /**
- * Jeśli napis reprezentuje wielomian, zostaje wrzucony na stos.
+ * Parsuje napis reprezentujący wielomian (lub współczynnik) do tego wielomianu.
+ * Napis jest sprawdzany i przetwarzany w jednym przebiegu od lewej do prawej.
+ * Wielomian dłuższy niż dwa fragmenty PARSE_CHUNK_LENGTH jest dzielony
+ * na najwyższym poziomie na ciągi jednomianów parsowane równolegle,
+ * a wynik jest taki sam, jak przy parsowaniu sekwencyjnym.
  * @param[in] str : napis
- * @param[in] line : aktualny nr wiersza
- * @param[in,out] stack : stos
- */
-void WordIsPoly(StringWithSize str, int line, PolyStack *stack);
-
-/**
- * Analizuje wiersz pod kątem bycia wielomianem, komendą lub niepoprawnym.
- * @param[in] str : wiersz
- * @param[in] line : aktualny nr wiersza
- * @param[in,out] stack : stos
+ * @param[in] begin : indeks początkowy
+ * @param[in] end : indeks końcowy
+ * @param[out] correct : czy wielomian jest poprawny
+ * @param[out] in_range : czy liczby mieszczą się w zakresach
+ * @return wielomian
  */
-void AnalyzeLine(StringWithSize str, int line, PolyStack *stack);
+Poly PolyFromString(StringWithSize str, size_t begin, size_t end,
+                    bool *correct, bool *in_range);
 
 #endif //PARSING_H
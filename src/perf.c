@@ -0,0 +1,197 @@
+/** @file
+  Implementacja pomiaru sprzętowych liczników wydajności.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "perf.h"
+#include "measure.h"
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/**
+ * To jest struktura przechowująca sumy liczników jednego rodzaju poleceń.
+ */
+typedef struct PerfEntry {
+    const char *name; ///< nazwa polecenia
+    unsigned long long count; ///< liczba wykonań
+    double values[PERF_EVENTS]; ///< sumy przyrostów liczników
+} PerfEntry;
+
+bool perf_enabled = false;
+
+/** Nazwy mierzonych zdarzeń. */
+static const char *const event_names[PERF_EVENTS] = {
+    "cycles", "instructions", "cache_misses", "branch_misses"
+};
+
+/** Deskryptory liczników, -1 dla niedostępnych. */
+static int event_fds[PERF_EVENTS] = {-1, -1, -1, -1};
+/** Pozycja licznika w odczycie grupy, -1 dla niedostępnych. */
+static int event_slots[PERF_EVENTS] = {-1, -1, -1, -1};
+/** Liczba otwartych liczników. */
+static int open_events = 0;
+/** Deskryptor lidera grupy liczników. */
+static int leader_fd = -1;
+
+/** Sumy liczników rodzajów poleceń. */
+static PerfEntry kinds[MEASURE_MAX_KINDS];
+/** Tabela sum liczników rodzajów poleceń. */
+static KindTable kind_table = {.entries = kinds,
+                               .entry_size = sizeof(PerfEntry)};
+
+#ifdef __linux__
+
+/** Identyfikatory zdarzeń sprzętowych w kolejności event_names. */
+static const unsigned long long event_configs[PERF_EVENTS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+
+/**
+ * Otwiera licznik zdarzenia dla bieżącego wątku.
+ * @param[in] config : identyfikator zdarzenia
+ * @param[in] group_fd : deskryptor lidera grupy lub -1
+ * @return deskryptor licznika lub -1
+ */
+static int OpenEvent(unsigned long long config, int group_fd) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group_fd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+void PerfEnable(void) {
+    for (int i = 0; i < PERF_EVENTS; i++) {
+        event_fds[i] = OpenEvent(event_configs[i], leader_fd);
+        if (event_fds[i] < 0)
+            continue;
+        if (leader_fd == -1)
+            leader_fd = event_fds[i];
+        event_slots[i] = open_events++;
+    }
+    if (leader_fd == -1) {
+        perror("perf_event_open");
+        fprintf(stderr, "hardware counters unavailable, --perf ignored\n");
+        return;
+    }
+    ioctl(leader_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    perf_enabled = true;
+}
+
+PerfSample PerfBegin(void) {
+    PerfSample sample;
+    unsigned long long buffer[3 + PERF_EVENTS] = {0};
+    ssize_t expected = (ssize_t) ((3 + open_events) * sizeof(buffer[0]));
+
+    sample.valid = read(leader_fd, buffer, sizeof(buffer)) == expected;
+    sample.enabled = buffer[1];
+    sample.running = buffer[2];
+    for (int i = 0; i < PERF_EVENTS; i++) {
+        sample.values[i] = event_slots[i] < 0 ? 0 : buffer[3 + event_slots[i]];
+    }
+    return sample;
+}
+
+#else
+
+void PerfEnable(void) {
+    fprintf(stderr, "hardware counters unavailable, --perf ignored\n");
+}
+
+PerfSample PerfBegin(void) {
+    PerfSample sample = {.valid = false};
+    return sample;
+}
+
+#endif
+
+void PerfEnd(const PerfSample *sample, const char *name) {
+    PerfSample end = PerfBegin();
+    PerfEntry *kind = FindKind(&kind_table, name);
+    if (!sample->valid || !end.valid || kind == NULL)
+        return;
+
+    // gdy liczników jest więcej niż rejestrów, jądro mierzy je na zmianę,
+    // więc przyrost skalujemy do czasu, w którym licznik był włączony
+    unsigned long long enabled = end.enabled - sample->enabled;
+    unsigned long long running = end.running - sample->running;
+    double scale = running > 0 ? (double) enabled / (double) running : 1.0;
+    kind->count++;
+    for (int i = 0; i < PERF_EVENTS; i++) {
+        kind->values[i] += (double) (end.values[i] - sample->values[i]) * scale;
+    }
+}
+
+/**
+ * Wypisuje wiersz tabeli liczników.
+ * @param[in] out : plik
+ * @param[in] entry : sumy liczników
+ */
+static void PrintEntry(FILE *out, const PerfEntry *entry) {
+    PrintKindLabel(out, entry->name, entry->count);
+    for (int i = 0; i < PERF_EVENTS; i++) {
+        if (event_slots[i] < 0) {
+            fprintf(out, " %14s", "n/a");
+        } else {
+            fprintf(out, " %14.0f", entry->values[i]);
+        }
+    }
+    if (event_slots[0] >= 0 && event_slots[1] >= 0 && entry->values[0] > 0) {
+        fprintf(out, " %6.2f\n", entry->values[1] / entry->values[0]);
+    } else {
+        fprintf(out, " %6s\n", "n/a");
+    }
+}
+
+void PerfReport(FILE *out) {
+    if (!perf_enabled)
+        return;
+
+    PrintKindHeader(out);
+    for (int i = 0; i < PERF_EVENTS; i++) {
+        fprintf(out, " %14s", event_names[i]);
+    }
+    fprintf(out, " %6s\n", "ipc");
+
+    PerfEntry total = {.name = "TOTAL"};
+    for (size_t i = 0; i < kind_table.count; i++) {
+        PrintEntry(out, &kinds[i]);
+        total.count += kinds[i].count;
+        for (int j = 0; j < PERF_EVENTS; j++) {
+            total.values[j] += kinds[i].values[j];
+        }
+    }
+    PrintEntry(out, &total);
+
+#ifdef __linux__
+    for (int i = 0; i < PERF_EVENTS; i++) {
+        if (event_fds[i] >= 0)
+            close(event_fds[i]);
+        event_fds[i] = event_slots[i] = -1;
+    }
+#endif
+    leader_fd = -1;
+    open_events = 0;
+    kind_table.count = 0;
+    perf_enabled = false;
+}
@@ -0,0 +1,66 @@
+/** @file
+  Sprzętowe liczniki wydajności (Linux perf_event_open) mierzone
+  dla każdego wykonanego polecenia kalkulatora (tryb --perf).
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * Liczba mierzonych zdarzeń: cykle, instrukcje, chybienia w pamięci
+ * podręcznej i błędnie przewidziane skoki.
+ */
+#define PERF_EVENTS 4
+
+/**
+ * To jest struktura przechowująca stan liczników na początku
+ * mierzonego polecenia.
+ */
+typedef struct PerfSample {
+    unsigned long long values[PERF_EVENTS]; ///< wartości liczników
+    unsigned long long enabled; ///< czas, przez który liczniki były włączone
+    unsigned long long running; ///< czas, przez który liczniki liczyły
+    bool valid; ///< czy udało się odczytać liczniki
+} PerfSample;
+
+/**
+ * Czy liczniki są mierzone?
+ */
+extern bool perf_enabled;
+
+/**
+ * Otwiera liczniki dla bieżącego wątku. Praca wątków pomocniczych nie jest
+ * liczona, więc wywołujący powinien wykonywać wszystko w tym wątku.
+ * Zdarzenia, których nie da się
+ * mierzyć (brak uprawnień, brak wsparcia sprzętu lub systemu), są pomijane,
+ * a jeśli nie da się mierzyć żadnego, wypisuje ostrzeżenie na stderr
+ * i pozostawia pomiar wyłączony.
+ */
+void PerfEnable(void);
+
+/**
+ * Odczytuje liczniki przed wykonaniem polecenia.
+ * @return stan liczników
+ */
+PerfSample PerfBegin(void);
+
+/**
+ * Dolicza przyrost liczników od PerfBegin do statystyk polecenia.
+ * @param[in] sample : stan liczników przed wykonaniem polecenia
+ * @param[in] name : nazwa polecenia
+ */
+void PerfEnd(const PerfSample *sample, const char *name);
+
+/**
+ * Wypisuje tabelę liczników dla każdego rodzaju poleceń i zamyka liczniki.
+ * @param[in] out : plik, do którego trafia tabela
+ */
+void PerfReport(FILE *out);
+
+#endif //PERF_H
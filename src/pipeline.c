@@ -0,0 +1,257 @@
+/** @file
+  Implementacja potokowego wykonywania kalkulatora.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include "pipeline.h"
+#include "commands.h"
+#include "mallocs.h"
+#include "input_output.h"
+#include "stats.h"
+#include "trace.h"
+
+/**
+ * To jest struktura przechowująca wiersz przygotowany do wykonania.
+ * Wielomian jest już sparsowany, a treść polecenia skopiowana do paczki.
+ */
+typedef struct ParsedLine {
+    int line; ///< nr wiersza
+    bool is_command; ///< czy wiersz jest poleceniem
+    bool correct; ///< czy wielomian jest poprawny
+    Poly p; ///< sparsowany wielomian
+    size_t text_begin; ///< indeks treści polecenia w pamięci paczki
+    size_t text_length; ///< długość treści polecenia (razem z '\n')
+} ParsedLine;
+
+/**
+ * To jest struktura przechowująca paczkę kolejnych niepustych wierszy.
+ */
+typedef struct LineBatch {
+    ParsedLine lines[PIPELINE_BATCH_SIZE]; ///< wiersze
+    size_t count; ///< liczba wierszy
+    StringWithSize text; ///< treść poleceń z tej paczki
+} LineBatch;
+
+/**
+ * To jest struktura przechowująca kolejkę paczek między wątkiem
+ * parsującym a wykonującym.
+ */
+typedef struct Pipeline {
+    InputReader *reader; ///< bufor wejścia, używany tylko przez wątek parsujący
+    LineBatch batches[PIPELINE_QUEUE_SIZE]; ///< cykliczna kolejka paczek
+    size_t head; ///< indeks najstarszej gotowej paczki
+    size_t filled; ///< liczba gotowych paczek
+    bool finished; ///< czy wątek parsujący skończył pracę
+    pthread_mutex_t mutex; ///< chroni pola head, filled i finished
+    pthread_cond_t not_empty; ///< sygnalizuje pojawienie się paczki
+    pthread_cond_t not_full; ///< sygnalizuje zwolnienie miejsca w kolejce
+} Pipeline;
+
+/**
+ * Czeka na wolne miejsce w kolejce i zwraca paczkę do wypełnienia.
+ * @param[in,out] pipeline : kolejka
+ * @return pusta paczka
+ */
+static LineBatch *AcquireBatch(Pipeline *pipeline) {
+    pthread_mutex_lock(&pipeline->mutex);
+    while (pipeline->filled == PIPELINE_QUEUE_SIZE) {
+        pthread_cond_wait(&pipeline->not_full, &pipeline->mutex);
+    }
+    size_t tail = (pipeline->head + pipeline->filled) % PIPELINE_QUEUE_SIZE;
+    pthread_mutex_unlock(&pipeline->mutex);
+
+    LineBatch *batch = &pipeline->batches[tail];
+    batch->count = 0;
+    batch->text.length = 0;
+    return batch;
+}
+
+/**
+ * Przekazuje wypełnioną paczkę do wykonania.
+ * @param[in,out] pipeline : kolejka
+ * @param[in] finished : czy to ostatnia paczka
+ */
+static void PublishBatch(Pipeline *pipeline, bool finished) {
+    pthread_mutex_lock(&pipeline->mutex);
+    pipeline->filled++;
+    pipeline->finished = finished;
+    pthread_cond_signal(&pipeline->not_empty);
+    pthread_mutex_unlock(&pipeline->mutex);
+}
+
+/**
+ * Kopiuje treść polecenia do pamięci paczki.
+ * @param[in,out] batch : paczka
+ * @param[in] str : wiersz z poleceniem
+ * @param[out] parsed : opis wiersza w paczce
+ */
+static void CopyCommand(LineBatch *batch, StringWithSize str,
+                        ParsedLine *parsed) {
+    size_t needed = batch->text.length + str.length;
+    if (needed > batch->text.size) {
+        size_t size = batch->text.size;
+        while (needed > size) {
+            size = MultiplySize(size);
+        }
+        SafeStringRealloc(&batch->text, size);
+    }
+    memcpy(batch->text.A + batch->text.length, str.A, str.length);
+    parsed->text_begin = batch->text.length;
+    parsed->text_length = str.length;
+    batch->text.length += str.length;
+}
+
+/**
+ * Funkcja wątku parsującego. Wczytuje wiersze, parsuje wielomiany
+ * i przekazuje paczki wierszy do wykonania.
+ * @param[in,out] arg : kolejka
+ * @return NULL
+ */
+static void *ParseLines(void *arg) {
+    Pipeline *pipeline = arg;
+    LineBatch *batch = AcquireBatch(pipeline);
+    StringWithSize str;
+    int line = 1;
+
+    while (ReadLine(pipeline->reader, &str)) {
+        if (str.A[0] != '\n') {
+            if (batch->count == PIPELINE_BATCH_SIZE) {
+                PublishBatch(pipeline, false);
+                batch = AcquireBatch(pipeline);
+            }
+
+            ParsedLine *parsed = &batch->lines[batch->count];
+            parsed->line = line;
+            parsed->is_command = IsCommandLine(str);
+            if (parsed->is_command) {
+                CopyCommand(batch, str, parsed);
+            } else {
+                TraceSpan span = TraceBegin();
+                bool in_range;
+                parsed->p = PolyFromLine(str, &parsed->correct, &in_range);
+                parsed->correct = parsed->correct && in_range;
+                TraceEnd(&span, STATS_POLY_NAME, TRACE_PARSE, line);
+            }
+            batch->count++;
+        }
+        line++;
+    }
+    PublishBatch(pipeline, true);
+    return NULL;
+}
+
+/**
+ * Wykonuje wiersze z paczki w kolejności wejścia.
+ * @param[in] batch : paczka
+ * @param[in,out] stack : stos
+ */
+static void ExecuteBatch(LineBatch *batch, PolyStack *stack) {
+    for (size_t i = 0; i < batch->count; i++) {
+        ParsedLine *parsed = &batch->lines[i];
+        if (parsed->is_command) {
+            StringWithSize str = {
+                .A = batch->text.A + parsed->text_begin,
+                .length = parsed->text_length,
+                .size = parsed->text_length
+            };
+            AnalyzeCommand(str, parsed->line, stack);
+        } else if (parsed->correct) {
+            // wielomian sparsował już drugi wątek, mierzymy tylko wstawienie
+            StatsSample sample;
+            if (stats_enabled)
+                sample = StatsBegin();
+            TraceSpan span = TraceBegin();
+            StackPush(stack, parsed->p);
+            TraceEnd(&span, STATS_POLY_NAME, TRACE_EXECUTE, parsed->line);
+            if (stats_enabled)
+                StatsEnd(&sample, STATS_POLY_NAME, parsed->line, stack);
+        } else {
+            PrintError(parsed->line, "WRONG POLY");
+        }
+    }
+}
+
+/**
+ * Czeka na kolejną paczkę. Przed czekaniem oddaje dotychczasowe wyniki,
+ * żeby zachować zachowanie interaktywne.
+ * @param[in,out] pipeline : kolejka
+ * @return paczka lub NULL, jeśli wszystkie paczki zostały wykonane
+ */
+static LineBatch *NextBatch(Pipeline *pipeline) {
+    pthread_mutex_lock(&pipeline->mutex);
+    if (pipeline->filled == 0 && !pipeline->finished) {
+        pthread_mutex_unlock(&pipeline->mutex);
+        FlushOutput();
+        pthread_mutex_lock(&pipeline->mutex);
+    }
+    while (pipeline->filled == 0 && !pipeline->finished) {
+        pthread_cond_wait(&pipeline->not_empty, &pipeline->mutex);
+    }
+    LineBatch *batch = NULL;
+    if (pipeline->filled > 0) {
+        batch = &pipeline->batches[pipeline->head];
+    }
+    pthread_mutex_unlock(&pipeline->mutex);
+    return batch;
+}
+
+/**
+ * Zwalnia miejsce w kolejce po wykonaniu najstarszej paczki.
+ * @param[in,out] pipeline : kolejka
+ */
+static void ReleaseBatch(Pipeline *pipeline) {
+    pthread_mutex_lock(&pipeline->mutex);
+    pipeline->head = (pipeline->head + 1) % PIPELINE_QUEUE_SIZE;
+    pipeline->filled--;
+    pthread_cond_signal(&pipeline->not_full);
+    pthread_mutex_unlock(&pipeline->mutex);
+}
+
+void RunPipelined(InputReader *reader, PolyStack *stack) {
+    Pipeline *pipeline = malloc(sizeof(Pipeline));
+    if (pipeline == NULL)
+        AllocationFailed();
+
+    pipeline->reader = reader;
+    pipeline->head = 0;
+    pipeline->filled = 0;
+    pipeline->finished = false;
+    for (size_t i = 0; i < PIPELINE_QUEUE_SIZE; i++) {
+        pipeline->batches[i].text = StringInit();
+        pipeline->batches[i].text.size = PIPELINE_TEXT_SIZE;
+        SafeStringMalloc(&pipeline->batches[i].text);
+    }
+    pthread_mutex_init(&pipeline->mutex, NULL);
+    pthread_cond_init(&pipeline->not_empty, NULL);
+    pthread_cond_init(&pipeline->not_full, NULL);
+
+    // wątek parsujący nie może dotykać buforów wyjścia
+    reader->flush_output = false;
+    pthread_t parser;
+    if (pthread_create(&parser, NULL, ParseLines, pipeline) == 0) {
+        LineBatch *batch;
+        while ((batch = NextBatch(pipeline)) != NULL) {
+            ExecuteBatch(batch, stack);
+            ReleaseBatch(pipeline);
+        }
+        pthread_join(parser, NULL);
+    } else {
+        reader->flush_output = true;
+        ExecuteLines(reader, stack);
+    }
+    reader->flush_output = true;
+
+    pthread_cond_destroy(&pipeline->not_full);
+    pthread_cond_destroy(&pipeline->not_empty);
+    pthread_mutex_destroy(&pipeline->mutex);
+    for (size_t i = 0; i < PIPELINE_QUEUE_SIZE; i++) {
+        StringFree(&pipeline->batches[i].text);
+    }
+    free(pipeline);
+}
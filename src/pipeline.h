@@ -0,0 +1,41 @@
+/** @file
+  Potokowe wykonywanie kalkulatora: wielomiany są parsowane w osobnym
+  wątku, równolegle z wykonywaniem poleceń.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include "input_output.h"
+#include "stack.h"
+
+/**
+ * Ile wierszy przekazujemy między wątkami naraz.
+ */
+#define PIPELINE_BATCH_SIZE 1024
+
+/**
+ * Ile paczek wierszy może czekać na wykonanie.
+ */
+#define PIPELINE_QUEUE_SIZE 4
+
+/**
+ * Początkowy rozmiar pamięci na treść poleceń w jednej paczce.
+ */
+#define PIPELINE_TEXT_SIZE 16384
+
+/**
+ * Wykonuje wszystkie wiersze wejścia. Osobny wątek wczytuje wiersze
+ * i parsuje wielomiany z wyprzedzeniem, a bieżący wątek wykonuje je
+ * w kolejności wejścia, więc wyniki i numery wierszy błędów są takie same,
+ * jak przy wykonywaniu sekwencyjnym.
+ * Jeśli nie uda się utworzyć wątku, wykonuje wiersze sekwencyjnie.
+ * @param[in,out] reader : bufor wejścia
+ * @param[in,out] stack : stos
+ */
+void RunPipelined(InputReader *reader, PolyStack *stack);
+
+#endif //PIPELINE_H
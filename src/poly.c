@@ -11,26 +11,138 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
 #include "poly.h"
 #include "mallocs.h"
+#include "input_output.h"
+#include "trace.h"
+
+/** Liczba wątków formatujących jeden wielomian. */
+static long print_threads = 1;
+
+void SetPrintThreads(long threads) {
+    if (threads < 1)
+        threads = 1;
+    if (threads > PRINT_MAX_THREADS)
+        threads = PRINT_MAX_THREADS;
+    print_threads = threads;
+}
+
+void PolyFormat(const Poly *p, StringWithSize *out) {
+    if (PolyIsCoeff(p)) {
+        CoeffAppend(out, p->coeff);
+    } else {
+        StringAppend(out, "(", 1);
+        for (size_t i = 0; i < p->size; i++) {
+            if (i)
+                StringAppend(out, ")+(", 3);
+            PolyFormat(&p->arr[i].p, out);
+            StringAppend(out, ",", 1);
+            StringAppendLong(out, MonoGetExp(p->arr + i));
+        }
+        StringAppend(out, ")", 1);
+    }
+}
+
+/**
+ * To jest struktura opisująca blok jednomianów formatowany przez jeden wątek.
+ */
+typedef struct PrintBlock {
+    const Mono *monos; ///< jednomiany bloku
+    size_t count; ///< liczba jednomianów
+    StringWithSize text; ///< sformatowane jednomiany, bez nawiasów zewnętrznych
+} PrintBlock;
+
+/**
+ * Funkcja wątku formatującego blok jednomianów.
+ * @param[in,out] arg : blok jednomianów
+ * @return NULL
+ */
+static void *FormatBlock(void *arg) {
+    PrintBlock *block = arg;
+    block->text.length = 0;
+    for (size_t i = 0; i < block->count; i++) {
+        if (i)
+            StringAppend(&block->text, ")+(", 3);
+        PolyFormat(&block->monos[i].p, &block->text);
+        StringAppend(&block->text, ",", 1);
+        StringAppendLong(&block->text, MonoGetExp(&block->monos[i]));
+    }
+    return NULL;
+}
+
+/**
+ * Wypisuje wielomian, formatując równolegle bloki jego jednomianów.
+ * Bloki są przetwarzane turami po @p threads, więc w pamięci jest naraz
+ * tylko tekst jednej tury. Pierwszy blok tury formatuje bieżący wątek.
+ * @param[in] p : wielomian niebędący współczynnikiem
+ * @param[in] threads : liczba wątków
+ */
+static void ParallelPolyPrint(const Poly *p, size_t threads) {
+    PrintBlock blocks[PRINT_MAX_THREADS];
+    pthread_t ids[PRINT_MAX_THREADS];
+    bool started[PRINT_MAX_THREADS];
+    for (size_t k = 0; k < threads; k++) {
+        blocks[k].text = StringInit();
+    }
+
+    PrintChar('(');
+    for (size_t first = 0; first < p->size;
+         first += threads * PRINT_BLOCK_MONOS) {
+        size_t count = 0;
+        for (size_t i = first; count < threads && i < p->size;
+             i += PRINT_BLOCK_MONOS) {
+            blocks[count].monos = p->arr + i;
+            blocks[count].count = p->size - i < PRINT_BLOCK_MONOS ?
+                                  p->size - i : PRINT_BLOCK_MONOS;
+            count++;
+        }
+
+        for (size_t k = 1; k < count; k++) {
+            started[k] = pthread_create(&ids[k], NULL, FormatBlock,
+                                        &blocks[k]) == 0;
+        }
+        FormatBlock(&blocks[0]);
+        for (size_t k = 0; k < count; k++) {
+            if (k > 0 && started[k]) {
+                pthread_join(ids[k], NULL);
+            } else if (k > 0) { // nie udało się utworzyć wątku
+                FormatBlock(&blocks[k]);
+            }
+            if (first > 0 || k > 0)
+                PrintString(")+(");
+            PrintBytes(blocks[k].text.A, blocks[k].text.length);
+        }
+    }
+    PrintChar(')');
+
+    for (size_t k = 0; k < threads; k++) {
+        StringFree(&blocks[k].text);
+    }
+}
 
 void PolyPrint(const Poly *p) {
+    if (print_threads > 1 && !PolyIsCoeff(p) &&
+        p->size >= 2 * PRINT_BLOCK_MONOS) {
+        TraceSpan span = TraceBegin();
+        ParallelPolyPrint(p, (size_t) print_threads);
+        TraceEnd(&span, "ParallelPolyPrint", TRACE_POLY, 0);
+        return;
+    }
     if (PolyIsCoeff(p)) {
-        if (printf("%ld", p->coeff) < 0)
-            exit(1);
+        CoeffPrint(p->coeff);
     } else {
-        if (printf("(") < 0)
-            exit(1);
+        PrintChar('(');
         for (size_t i = 0; i < p->size; i++) {
             if (i)
-                if (printf(")+(") < 0)
-                    exit(1);
+                PrintString(")+(");
             PolyPrint(&p->arr[i].p);
-            if (printf(",%d", MonoGetExp(p->arr + i)) < 0)
-                exit(1);
+            PrintChar(',');
+            PrintLong(MonoGetExp(p->arr + i));
         }
-        if (printf(")") < 0)
-            exit(1);
+        PrintChar(')');
     }
 }
 
@@ -40,7 +152,9 @@ void PolyDestroy(Poly *p) {
         for (size_t i = 0; i < p->size; i++) {
             MonoDestroy(&p->arr[i]);
         }
-        free(p->arr);
+        MonoArrayFree(p->arr, p->size);
+    } else {
+        CoeffDestroy(p->coeff);
     }
     *p = PolyZero();
 }
@@ -49,7 +163,7 @@ void MonosArrayDestroy(size_t size, Mono *monos) {
     for (size_t j = 0; j < size; j++) {
         MonoDestroy(&monos[j]);
     }
-    free(monos);
+    MonoArrayFree(monos, size);
 }
 
 Poly PolyClone(const Poly *p) {
@@ -57,7 +171,7 @@ Poly PolyClone(const Poly *p) {
     Poly copy = PolyZero();
 
     if (PolyIsCoeff(p)) {
-        copy = PolyFromCoeff(p->coeff);
+        copy = PolyFromCoeff(CoeffClone(p->coeff));
     } else {
         copy.size = p->size;
         SafeMonoMalloc(&copy.arr, copy.size);
@@ -69,62 +183,140 @@ Poly PolyClone(const Poly *p) {
 }
 
 /**
- * Porównuje wykładniki dwóch jednomianów.
- * @param[in] a : jednomian
- * @param[in] b : jednomian
- * @return 0, gdy wykładniki równe;
- * -1, gdy wykładnik a mniejszy od wykładnika b;
- * 1, w przeciwnym wypadku
+ * Największa liczba jednomianów sortowana przez wstawianie.
+ */
+#define INSERTION_SORT_MAX 32
+
+/**
+ * Liczba bitów cyfry wykładnika w sortowaniu pozycyjnym.
+ */
+#define RADIX_BITS 8
+
+/**
+ * Liczba możliwych wartości cyfry wykładnika.
  */
-static int ExpComparator(const void *a, const void *b) {
-    Mono _a = *(Mono *) a;
-    Mono _b = *(Mono *) b;
-    if (MonoGetExp(&_a) < MonoGetExp(&_b)) return -1;
-    else if (MonoGetExp(&_a) == MonoGetExp(&_b)) return 0;
-    else return 1;
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+
+/**
+ * Liczba cyfr wykładnika.
+ */
+#define RADIX_PASSES ((int) (sizeof(poly_exp_t) * CHAR_BIT / RADIX_BITS))
+
+/**
+ * Zwraca cyfrę wykładnika jednomianu.
+ * @param[in] m : jednomian
+ * @param[in] pass : nr cyfry, od najmniej znaczącej
+ * @return cyfra
+ */
+static inline unsigned ExpDigit(const Mono *m, int pass) {
+    return (unsigned) MonoGetExp(m) >> (pass * RADIX_BITS) &
+           (RADIX_BUCKETS - 1);
+}
+
+/**
+ * Sortuje małą tablicę jednomianów przez wstawianie.
+ * @param[in] size : liczba elementów tablicy
+ * @param[in,out] monos : tablica jednomianów
+ */
+static void InsertionSortMonos(size_t size, Mono monos[]) {
+    for (size_t i = 1; i < size; i++) {
+        Mono mono = monos[i];
+        size_t j = i;
+        while (j > 0 && MonoGetExp(&monos[j - 1]) > MonoGetExp(&mono)) {
+            monos[j] = monos[j - 1];
+            j--;
+        }
+        monos[j] = mono;
+    }
 }
 
 /**
  * Sortuje tablicę jednomianów rosnąco po ich wykładnikach.
+ * Duże tablice sortujemy pozycyjnie od najmniej znaczącej cyfry
+ * wykładnika (wykładniki są nieujemne), pomijając cyfry równe we
+ * wszystkich wykładnikach - zwykle wykładniki są małe i wystarcza
+ * jeden przebieg. Histogramy wszystkich cyfr liczymy w jednym przejściu,
+ * które przy okazji wykrywa tablicę już posortowaną.
  * @param[in] size : liczba elementów tablicy
- * @param[in] monos[] : tablica jednomianów
+ * @param[in,out] monos : tablica jednomianów
  */
 static void SortMonosByExp(size_t size, Mono monos[]) {
-    qsort(monos, size, sizeof(Mono), ExpComparator);
+    if (size <= INSERTION_SORT_MAX) {
+        InsertionSortMonos(size, monos);
+        return;
+    }
+
+    size_t counts[RADIX_PASSES][RADIX_BUCKETS] = {{0}};
+    bool sorted = true;
+    for (size_t i = 0; i < size; i++) {
+        assert(MonoGetExp(&monos[i]) >= 0);
+        for (int pass = 0; pass < RADIX_PASSES; pass++) {
+            counts[pass][ExpDigit(&monos[i], pass)]++;
+        }
+        if (i > 0 && MonoGetExp(&monos[i - 1]) > MonoGetExp(&monos[i]))
+            sorted = false;
+    }
+    if (sorted)
+        return;
+
+    Mono *buffer = SafeBytesMalloc(size * sizeof(Mono));
+    Mono *from = monos, *to = buffer;
+    for (int pass = 0; pass < RADIX_PASSES; pass++) {
+        size_t *count = counts[pass];
+        if (count[ExpDigit(&from[0], pass)] == size)
+            continue; // przebieg niczego by nie zmienił
+
+        size_t offset = 0;
+        for (size_t b = 0; b < RADIX_BUCKETS; b++) {
+            size_t bucket = count[b];
+            count[b] = offset;
+            offset += bucket;
+        }
+        for (size_t i = 0; i < size; i++) {
+            to[count[ExpDigit(&from[i], pass)]++] = from[i];
+        }
+        Mono *swap = from;
+        from = to;
+        to = swap;
+    }
+    if (from != monos)
+        memcpy(monos, from, size * sizeof(Mono));
+    BytesFree(buffer, size * sizeof(Mono));
 }
 
 Poly PolyAddToCoeff(const Poly *p, poly_coeff_t c) {
-    Poly pp = PolyClone(p);
-    Poly qq = PolyFromCoeff(c);
-    SortMonosByExp(pp.size, pp.arr);
-
-    if (c != 0) {
-        if (MonoGetExp(&pp.arr[0]) == 0) {
-            Poly tmp = PolyAdd(&pp.arr[0].p, &qq);
+    assert(!PolyIsCoeff(p));
+    if (CoeffIsZero(c)) {
+        return PolyClone(p);
+    }
+
+    // nowy wyraz wolny; pozostałe jednomiany kopiujemy raz, bez sortowania
+    Poly qq = PolyFromCoeff(c); // pożyczony, nie jest usuwany
+    Poly constant;
+    size_t first = 0;
+    if (MonoGetExp(&p->arr[0]) == 0) {
+        constant = PolyAdd(&p->arr[0].p, &qq);
+        first = 1;
+    } else {
+        constant = PolyClone(&qq);
+    }
 
-            if (!PolyIsZero(&tmp)) {
-                PolyDestroy(&pp.arr[0].p);
-                pp.arr[0].p = tmp;
-            } else { // usuwamy jednomian przy zerowym wykładniku
-                // nadaję mu najwyższy wykładnik, sortuję
-                //  i realokuję na o 1 mniej elementów
-                pp.arr[0].exp = MonoGetExp(&pp.arr[pp.size - 1]) + 1;
-                SortMonosByExp(pp.size, pp.arr);
-                pp.size--;
-                SafeMonoRealloc(&pp.arr, pp.size);
-            }
-        } else { // wielomian pp nie ma jednomianu przy wykładniku 0
-            pp.size++;
-            SafeMonoRealloc(&pp.arr, pp.size);
-            pp.arr[pp.size - 1] = MonoFromPoly(&qq, 0);
-            SortMonosByExp(pp.size, pp.arr);
-        }
+    Poly res;
+    res.size = p->size - first + !PolyIsZero(&constant);
+    SafeMonoMalloc(&res.arr, res.size);
+    size_t num = 0;
+    if (!PolyIsZero(&constant)) {
+        res.arr[num++] = MonoFromPoly(&constant, 0);
     }
-    return pp;
+    for (size_t i = first; i < p->size; i++) {
+        res.arr[num++] = MonoClone(&p->arr[i]);
+    }
+    return res;
 }
 
 void PolyToCoeff(Poly *p) {
     poly_coeff_t co = p->arr[0].p.coeff;
+    p->arr[0].p = PolyZero(); // współczynnik przenosimy do wyniku
     PolyDestroy(p);
     p->coeff = co;
 }
@@ -192,7 +384,7 @@ Poly PolyAdd(const Poly *p, const Poly *q) {
     Poly sum;
 
     if (PolyIsCoeff(p) && PolyIsCoeff(q)) {
-        return PolyFromCoeff(p->coeff + q->coeff);
+        return PolyFromCoeff(CoeffAdd(p->coeff, q->coeff));
     }
 
     if (PolyIsCoeff(p)) {
@@ -201,19 +393,18 @@ Poly PolyAdd(const Poly *p, const Poly *q) {
         return PolyAddToCoeff(p, q->coeff);
     }
 
-    Poly pp = PolyClone(p);
-    Poly qq = PolyClone(q);
-    SortMonosByExp(pp.size, pp.arr);
-    SortMonosByExp(qq.size, qq.arr);
+    // scalamy bezpośrednio posortowane listy jednomianów argumentów,
+    // kopiując tylko jednomiany, które trafiają do wyniku
+    size_t capacity = p->size + q->size;
+    SafeMonoMalloc(&sum.arr, capacity);
 
-    SafeMonoMalloc(&sum.arr, pp.size + qq.size);
-
-    FillPolySum(&sum, pp, qq);
+    FillPolySum(&sum, *p, *q);
 
     if (sum.size == 0) { // wszystkie jednomiany się wyzerowały ze sobą
-        PolyDestroy(&sum);
-    } else {
-        SafeMonoRealloc(&sum.arr, sum.size);
+        MonoArrayFree(sum.arr, capacity);
+        sum = PolyZero();
+    } else if (sum.size < capacity) {
+        SafeMonoRealloc(&sum.arr, capacity, sum.size);
     }
 
     if (sum.size == 1 && MonoGetExp(&sum.arr[0]) == 0 &&
@@ -221,12 +412,75 @@ Poly PolyAdd(const Poly *p, const Poly *q) {
         // otrzymaliśmy wielomian tożsamościowo równy współczynnikowi
         PolyToCoeff(&sum);
     }
-
-    PolyDestroy(&pp);
-    PolyDestroy(&qq);
     return sum;
 }
 
+/**
+ * Sprawdza, czy tablica jednomianów jest już w postaci docelowej:
+ * wykładniki są ściśle rosnące, a współczynniki niezerowe.
+ * @param[in] count : liczba jednomianów
+ * @param[in] monos : tablica jednomianów
+ * @return czy tablicę można bezpośrednio użyć jako wielomian
+ */
+static bool MonosAreNormalized(size_t count, const Mono monos[]) {
+    for (size_t i = 0; i < count; i++) {
+        if (PolyIsZero(&monos[i].p) ||
+            (i > 0 && MonoGetExp(&monos[i - 1]) >= MonoGetExp(&monos[i]))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Sumuje współczynniki ciągu jednomianów o równych wykładnikach,
+ * przejmując je na własność. Współczynniki stałe dodajemy bezpośrednio,
+ * a jednomiany pozostałych przenosimy do jednej tablicy i sumujemy jednym
+ * wywołaniem PolyOwnMonos. Koszt jest liniowy względem łącznego rozmiaru
+ * ciągu (z dokładnością do sortowania), a nie kwadratowy jak przy
+ * kolejnych wywołaniach PolyAdd kopiujących akumulator.
+ * @param[in] count : długość ciągu
+ * @param[in] run : jednomiany ciągu
+ * @return suma współczynników jednomianów
+ */
+static Poly SumRun(size_t count, Mono run[]) {
+    if (count == 1)
+        return run[0].p;
+
+    poly_coeff_t constant = CoeffFromWord(0);
+    size_t total = 0;
+    for (size_t k = 0; k < count; k++) {
+        if (PolyIsCoeff(&run[k].p)) {
+            poly_coeff_t sum = CoeffAdd(constant, run[k].p.coeff);
+            CoeffDestroy(constant);
+            PolyDestroy(&run[k].p);
+            constant = sum;
+        } else {
+            total += run[k].p.size;
+        }
+    }
+    if (total == 0)
+        return PolyFromCoeff(constant);
+
+    total += !CoeffIsZero(constant);
+    Mono *inner;
+    SafeMonoMalloc(&inner, total);
+    size_t n = 0;
+    for (size_t k = 0; k < count; k++) {
+        Poly *p = &run[k].p;
+        if (!PolyIsCoeff(p)) {
+            memcpy(inner + n, p->arr, p->size * sizeof(Mono));
+            n += p->size;
+            MonoArrayFree(p->arr, p->size);
+        }
+    }
+    if (n < total) {
+        Poly p = PolyFromCoeff(constant);
+        inner[n] = MonoFromPoly(&p, 0);
+    }
+    return PolyOwnMonos(total, inner);
+}
+
 /**
  * Funkcja pomocnicza dla PolyAddMonos, PolyOwnMonos i PolyCloneMonos.
  * Przejmuje na własność zawartość tablicy @p monos i jej zawartość.
@@ -236,39 +490,55 @@ Poly PolyAdd(const Poly *p, const Poly *q) {
  */
 static Poly PolyAddMonosHelper(size_t count, Mono monos[]) {
     Poly res;
+    TraceSpan span = TraceBegin();
+
+    if (count > 0 && MonosAreNormalized(count, monos)) {
+        // np. jednomiany sparsowane z posortowanego napisu -
+        // nie trzeba ich sortować ani sumować
+        res.size = count;
+        res.arr = monos;
+        if (res.size == 1 && MonoGetExp(&res.arr[0]) == 0 &&
+            PolyIsCoeff(&res.arr[0].p)) {
+            PolyToCoeff(&res);
+        }
+        TraceEnd(&span, "PolyAddMonos", TRACE_POLY, 0);
+        return res;
+    }
+
     SortMonosByExp(count, monos);
-    SafeMonoMalloc(&res.arr, count);
 
+    // sumy ciągów wpisujemy w miejsce już zużytych jednomianów
     size_t i = 0, num = 0;
     while (i < count) {
-        res.arr[num].p = PolyZero();
-        res.arr[num].exp = MonoGetExp(&monos[i]);
-
-        size_t j = i;
+        size_t j = i + 1;
         while (j < count && MonoGetExp(&monos[j]) == MonoGetExp(&monos[i])) {
-            Poly tmp = PolyAdd(&res.arr[num].p, &monos[j].p);
-            PolyDestroy(&res.arr[num].p);
-            res.arr[num].p = tmp;
             j++;
         }
-        if (!PolyIsZero(&res.arr[num].p)) {
+        poly_exp_t exp = MonoGetExp(&monos[i]);
+        Poly sum = SumRun(j - i, &monos[i]);
+        if (!PolyIsZero(&sum)) {
+            monos[num] = MonoFromPoly(&sum, exp);
             num++;
         }
         i = j;
     }
-    res.size = num;
-    if (res.size == 0) {
-        PolyDestroy(&res);
-    } else {
-        SafeMonoRealloc(&res.arr, res.size);
+    if (num == 0) {
+        MonoArrayFree(monos, count);
+        TraceEnd(&span, "PolyAddMonos", TRACE_POLY, 0);
+        return PolyZero();
     }
+    if (num < count) {
+        SafeMonoRealloc(&monos, count, num);
+    }
+    res.size = num;
+    res.arr = monos;
 
     if (res.size == 1 && MonoGetExp(&res.arr[0]) == 0 &&
         PolyIsCoeff(&res.arr[0].p)) {
         // otrzymaliśmy wielomian tożsamościowo równy współczynnikowi
         PolyToCoeff(&res);
     }
-    MonosArrayDestroy(count, monos);
+    TraceEnd(&span, "PolyAddMonos", TRACE_POLY, 0);
     return res;
 }
 
@@ -425,12 +695,13 @@ Poly PolyMul(const Poly *p, const Poly *q) {
     assert(p && q);
 
     if (PolyIsCoeff(p) && PolyIsCoeff(q)) {
-        return PolyFromCoeff(p->coeff * q->coeff);
+        return PolyFromCoeff(CoeffMul(p->coeff, q->coeff));
     }
     if (PolyIsZero(p) || PolyIsZero(q)) {
         return PolyZero();
     }
 
+    TraceSpan span = TraceBegin();
     Poly pp, qq;
     if (PolyIsCoeff(p)) {
         CoeffToPoly(p, &pp);
@@ -461,15 +732,17 @@ Poly PolyMul(const Poly *p, const Poly *q) {
         }
     }
 
-    if (PolyIsCoeff(p) && !PolyIsZero(p)) {
-        PolyDestroy(&pp);
+    // jednomian utworzony przez CoeffToPoly pożycza współczynnik
+    if (PolyIsCoeff(p)) {
+        MonoArrayFree(pp.arr, pp.size);
     }
-    if (PolyIsCoeff(q) && !PolyIsZero(q)) {
-        PolyDestroy(&qq);
+    if (PolyIsCoeff(q)) {
+        MonoArrayFree(qq.arr, qq.size);
     }
 
     Poly res = PolyAddMonos(ps * qs, monos);
-    free(monos);
+    MonoArrayFree(monos, ps * qs);
+    TraceEnd(&span, "PolyMul", TRACE_POLY, 0);
     return res;
 }
 
@@ -482,7 +755,9 @@ Poly PolyMul(const Poly *p, const Poly *q) {
 static Poly PolyNegHelper(Poly *p) {
     assert(p);
     if (PolyIsCoeff(p)) {
-        *p = PolyFromCoeff(-p->coeff);
+        poly_coeff_t neg = CoeffNeg(p->coeff);
+        CoeffDestroy(p->coeff);
+        *p = PolyFromCoeff(neg);
     } else {
         for (size_t i = 0; i < p->size; i++) {
             p->arr[i].p = PolyNegHelper(&p->arr[i].p);
@@ -513,8 +788,7 @@ poly_exp_t PolyDegBy(const Poly *p, size_t var_idx) {
         return 0;
     }
 
-    if (var_idx == 0) {
-        SortMonosByExp(p->size, p->arr);
+    if (var_idx == 0) { // jednomiany są posortowane po wykładnikach
         return MonoGetExp(&p->arr[p->size - 1]);
     } else {
         poly_exp_t maxi = 0;
@@ -552,12 +826,10 @@ bool PolyIsEq(const Poly *p, const Poly *q) {
     assert(p && q);
 
     if (PolyIsCoeff(p) && PolyIsCoeff(q)) {
-        return p->coeff == q->coeff;
+        return CoeffEq(p->coeff, q->coeff);
     } else if (!PolyIsCoeff(p) && !PolyIsCoeff(q)) {
         if (p->size == q->size) {
-            SortMonosByExp(p->size, p->arr);
-            SortMonosByExp(q->size, q->arr);
-
+            // obie listy jednomianów są posortowane po wykładnikach
             for (size_t i = 0; i < p->size; i++) {
                 if (MonoGetExp(&p->arr[i]) != MonoGetExp(&q->arr[i]) ||
                     !PolyIsEq(&p->arr[i].p, &q->arr[i].p)) {
@@ -582,27 +854,35 @@ bool PolyIsEq(const Poly *p, const Poly *q) {
 static poly_coeff_t CoeffPower(poly_coeff_t x, poly_exp_t exp) {
     assert(exp >= 0);
 
-    poly_coeff_t res = 1;
+    poly_coeff_t res = CoeffFromWord(1);
+    poly_coeff_t base = CoeffClone(x);
     while (exp > 0) {
         if (exp % 2 == 1) {
-            res *= x;
+            poly_coeff_t mul = CoeffMul(res, base);
+            CoeffDestroy(res);
+            res = mul;
         }
-        x *= x;
+        poly_coeff_t square = CoeffMul(base, base);
+        CoeffDestroy(base);
+        base = square;
         exp /= 2;
     }
+    CoeffDestroy(base);
     return res;
 }
 
 Poly PolyAt(const Poly *p, poly_coeff_t x) {
     assert(p);
+    x = CoeffReduce(x);
 
     if (PolyIsCoeff(p)) {
-        return PolyFromCoeff(p->coeff);
+        return PolyClone(p);
     }
     Poly res = PolyZero();
     for (size_t i = 0; i < p->size; i++) {
         Poly coeff = PolyFromCoeff(CoeffPower(x, MonoGetExp(&p->arr[i])));
         Poly mul = PolyMul(&p->arr[i].p, &coeff);
+        PolyDestroy(&coeff);
         Poly tmp = PolyAdd(&res, &mul);
         PolyDestroy(&mul);
         PolyDestroy(&res);
@@ -614,8 +894,9 @@ Poly PolyAt(const Poly *p, poly_coeff_t x) {
 Poly PolyPower(const Poly *p, poly_exp_t exp) {
     assert(exp >= 0);
 
+    TraceSpan span = TraceBegin();
     Poly clone = PolyClone(p);
-    Poly res = PolyFromCoeff(1);
+    Poly res = PolyFromCoeff(CoeffFromWord(1));
     while (exp > 0) {
         if (exp % 2 == 1) {
             Poly mul = PolyMul(&res, &clone);
@@ -628,12 +909,13 @@ Poly PolyPower(const Poly *p, poly_exp_t exp) {
         exp /= 2;
     }
     PolyDestroy(&clone);
+    TraceEnd(&span, "PolyPower", TRACE_POLY, 0);
     return res;
 }
 
 Poly PolyCompose(const Poly *p, size_t k, const Poly q[]) {
     if (PolyIsCoeff(p)) {
-        return PolyFromCoeff(p->coeff);
+        return PolyClone(p);
     }
     if (k == 0) {
         if (MonoGetExp(&(p->arr[0])) == 0)
@@ -643,6 +925,7 @@ Poly PolyCompose(const Poly *p, size_t k, const Poly q[]) {
     }
     assert(k > 0 && q != NULL);
 
+    TraceSpan span = TraceBegin();
     Mono *monos = NULL;
     size_t count = 0;
     for (size_t i = 0; i < p->size; i++) {
@@ -654,19 +937,19 @@ Poly PolyCompose(const Poly *p, size_t k, const Poly q[]) {
 
         if (PolyIsCoeff(&mul)) {
             count++;
-            SafeMonoRealloc(&monos, count);
+            SafeMonoRealloc(&monos, count - 1, count);
             monos[count - 1] = MonoFromPoly(&mul, 0);
         } else {
-            SafeMonoRealloc(&monos, count + mul.size);
+            SafeMonoRealloc(&monos, count, count + mul.size);
             for (size_t j = 0; j < mul.size; j++) {
                 count++;
                 monos[count - 1] = mul.arr[j];
             }
-            free(mul.arr);
+            MonoArrayFree(mul.arr, mul.size);
         }
     }
     Poly res = PolyOwnMonos(count, monos);
-
+    TraceEnd(&span, "PolyCompose", TRACE_POLY, 0);
     return res;
 }
 
@@ -14,9 +14,7 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
-
-/** To jest typ reprezentujący współczynniki. */
-typedef long poly_coeff_t;
+#include "coeff.h"
 
 /** To jest typ reprezentujący wykładniki. */
 typedef int poly_exp_t;
@@ -27,6 +25,10 @@ struct Mono;
  * To jest struktura przechowująca wielomian.
  * Wielomian jest albo liczbą całkowitą, czyli wielomianem stałym
  * (wtedy `arr == NULL`), albo niepustą listą jednomianów (wtedy `arr != NULL`).
+ * Jednomiany są posortowane ściśle rosnąco po wykładnikach i mają niezerowe
+ * współczynniki - zapewniają to wszystkie funkcje tworzące wielomiany.
+ * Dzięki temu funkcje przyjmujące `const Poly *` niczego w nim nie zmieniają
+ * i wiele wątków może jednocześnie czytać ten sam wielomian.
  */
 typedef struct Poly {
     /**
@@ -77,7 +79,7 @@ static inline Poly PolyFromCoeff(poly_coeff_t c) {
  * @return wielomian
  */
 static inline Poly PolyZero(void) {
-    return PolyFromCoeff(0);
+    return PolyFromCoeff(CoeffFromWord(0));
 }
 
 static inline bool PolyIsZero(const Poly *p);
@@ -109,15 +111,45 @@ static inline bool PolyIsCoeff(const Poly *p) {
  * @return Czy wielomian jest równy zeru?
  */
 static inline bool PolyIsZero(const Poly *p) {
-    return PolyIsCoeff(p) && p->coeff == 0;
+    return PolyIsCoeff(p) && CoeffIsZero(p->coeff);
 }
 
+/**
+ * Maksymalna liczba wątków formatujących jeden wielomian.
+ */
+#define PRINT_MAX_THREADS 64
+
+/**
+ * Liczba jednomianów najwyższego poziomu formatowanych naraz przez jeden wątek.
+ */
+#define PRINT_BLOCK_MONOS 16384
+
+/**
+ * Ustawia liczbę wątków, którymi formatowany jest wielomian o wielu
+ * jednomianach (domyślnie 1). Liczba jest przycinana do przedziału
+ * [1, PRINT_MAX_THREADS].
+ * @param[in] threads : liczba wątków
+ */
+void SetPrintThreads(long threads);
+
 /**
  * Wypisuje wielomian w postaci nawiasowo-plusowej.
+ * Wielomian o co najmniej dwóch blokach PRINT_BLOCK_MONOS jednomianów
+ * najwyższego poziomu jest formatowany równolegle do buforów wątków,
+ * wypisywanych w kolejności jednomianów, z takim samym wynikiem.
  * @param[in] p : wielomian
  */
 void PolyPrint(const Poly *p);
 
+struct StringWithSize;
+
+/**
+ * Dopisuje wielomian w postaci nawiasowo-plusowej do napisu.
+ * @param[in] p : wielomian
+ * @param[in,out] out : napis
+ */
+void PolyFormat(const Poly *p, struct StringWithSize *out);
+
 /**
  * Usuwa wielomian z pamięci.
  * @param[in] p : wielomian
@@ -0,0 +1,451 @@
+/** @file
+  Mikrobenchmarki operacji biblioteki Poly.
+
+  Każdy parametr wielomianów (liczba jednomianów na poziomie, głębokość
+  zagnieżdżenia, odstęp między wykładnikami, liczba bitów współczynników)
+  można podać jako listę wartości oddzielonych przecinkami - benchmarki
+  są uruchamiane dla każdej kombinacji. Wyniki są wypisywane w formacie
+  CSV lub JSON, razem ze średnią liczbą alokacji i realokacji pamięci
+  przypadającą na jedno uruchomienie operacji.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include "poly.h"
+#include "mallocs.h"
+#include "parsing.h"
+#include "input_output.h"
+#include "measure.h"
+
+/**
+ * Maksymalna liczba wartości jednego parametru.
+ */
+#define MAX_PARAM_VALUES 16
+
+/**
+ * To jest struktura przechowująca listę wartości parametru.
+ */
+typedef struct ParamList {
+    long values[MAX_PARAM_VALUES]; ///< wartości
+    size_t count; ///< liczba wartości
+} ParamList;
+
+/**
+ * To jest struktura przechowująca parametry generowanych wielomianów.
+ */
+typedef struct PolyShape {
+    long terms; ///< liczba jednomianów na każdym poziomie
+    long depth; ///< głębokość zagnieżdżenia (liczba zmiennych)
+    long sparsity; ///< odstęp między kolejnymi wykładnikami
+    long coeff_bits; ///< liczba bitów wartości bezwzględnej współczynników
+} PolyShape;
+
+/**
+ * To jest struktura przechowująca dane jednego uruchomienia benchmarku.
+ */
+typedef struct BenchInput {
+    Poly p; ///< pierwszy argument
+    Poly q; ///< drugi argument
+    Poly *args; ///< wielomiany podstawiane w PolyCompose
+    size_t arg_count; ///< liczba wielomianów podstawianych w PolyCompose
+    StringWithSize text; ///< napis reprezentujący wielomian @p p
+} BenchInput;
+
+/**
+ * To jest typ funkcji wykonującej mierzoną operację.
+ * @param[in] input : dane
+ */
+typedef void (*BenchFunction)(const BenchInput *input);
+
+/**
+ * To jest struktura opisująca benchmark.
+ */
+typedef struct Benchmark {
+    const char *name; ///< nazwa
+    BenchFunction run; ///< mierzona operacja
+} Benchmark;
+
+/** Stan generatora liczb pseudolosowych. */
+static unsigned long long rng_state;
+
+/**
+ * Losuje kolejną liczbę (generator splitmix64).
+ * @return liczba pseudolosowa
+ */
+static unsigned long long NextRandom(void) {
+    unsigned long long z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Losuje niezerowy współczynnik o zadanej liczbie bitów.
+ * @param[in] bits : liczba bitów wartości bezwzględnej (od 1 do 62)
+ * @return współczynnik
+ */
+static poly_coeff_t RandomCoeff(long bits) {
+    unsigned long long mask = (1ULL << bits) - 1;
+    poly_coeff_t c = (poly_coeff_t) (NextRandom() & mask);
+    if (c == 0)
+        c = 1;
+    return (NextRandom() & 1) ? c : -c;
+}
+
+/**
+ * Tworzy losowy wielomian o zadanym kształcie.
+ * @param[in] shape : parametry wielomianu
+ * @param[in] depth : pozostała głębokość zagnieżdżenia
+ * @return wielomian
+ */
+static Poly RandomPoly(const PolyShape *shape, long depth) {
+    if (depth == 0)
+        return PolyFromCoeff(RandomCoeff(shape->coeff_bits));
+
+    Mono *monos = malloc((size_t) shape->terms * sizeof(Mono));
+    if (monos == NULL)
+        exit(1);
+    for (long i = 0; i < shape->terms; i++) {
+        Poly p = RandomPoly(shape, depth - 1);
+        monos[i] = MonoFromPoly(&p, (poly_exp_t) (i * shape->sparsity));
+    }
+    return PolyOwnMonos((size_t) shape->terms, monos);
+}
+
+/**
+ * Dopisuje znaki do napisu, powiększając go w razie potrzeby.
+ * @param[in,out] str : napis
+ * @param[in] s : dopisywane znaki
+ */
+static void Append(StringWithSize *str, const char *s) {
+    size_t length = strlen(s);
+    while (str->length + length + 1 >= str->size) {
+        str->size = 2 * str->size + 1;
+        str->A = realloc(str->A, str->size);
+        if (str->A == NULL)
+            exit(1);
+    }
+    memcpy(str->A + str->length, s, length);
+    str->length += length;
+}
+
+/**
+ * Zapisuje wielomian w postaci nawiasowo-plusowej do napisu.
+ * @param[in,out] str : napis
+ * @param[in] p : wielomian
+ */
+static void PolyToString(StringWithSize *str, const Poly *p) {
+    char number[32];
+    if (PolyIsCoeff(p)) {
+        sprintf(number, "%ld", p->coeff);
+        Append(str, number);
+        return;
+    }
+    for (size_t i = 0; i < p->size; i++) {
+        Append(str, i ? "+(" : "(");
+        PolyToString(str, &p->arr[i].p);
+        sprintf(number, ",%d)", p->arr[i].exp);
+        Append(str, number);
+    }
+}
+
+/**
+ * Mierzy PolyAdd.
+ * @param[in] input : dane
+ */
+static void BenchAdd(const BenchInput *input) {
+    Poly r = PolyAdd(&input->p, &input->q);
+    PolyDestroy(&r);
+}
+
+/**
+ * Mierzy PolyMul.
+ * @param[in] input : dane
+ */
+static void BenchMul(const BenchInput *input) {
+    Poly r = PolyMul(&input->p, &input->q);
+    PolyDestroy(&r);
+}
+
+/**
+ * Mierzy PolyPower (do potęgi 3).
+ * @param[in] input : dane
+ */
+static void BenchPower(const BenchInput *input) {
+    Poly r = PolyPower(&input->p, 3);
+    PolyDestroy(&r);
+}
+
+/**
+ * Mierzy PolyCompose.
+ * @param[in] input : dane
+ */
+static void BenchCompose(const BenchInput *input) {
+    Poly r = PolyCompose(&input->p, input->arg_count, input->args);
+    PolyDestroy(&r);
+}
+
+/**
+ * Mierzy PolyAt.
+ * @param[in] input : dane
+ */
+static void BenchAt(const BenchInput *input) {
+    Poly r = PolyAt(&input->p, 3);
+    PolyDestroy(&r);
+}
+
+/**
+ * Mierzy PolyIsEq na dwóch równych wielomianach.
+ * @param[in] input : dane
+ */
+static void BenchIsEq(const BenchInput *input) {
+    if (!PolyIsEq(&input->p, &input->p))
+        exit(1);
+}
+
+/**
+ * Mierzy PolyFromString.
+ * @param[in] input : dane
+ */
+static void BenchFromString(const BenchInput *input) {
+    bool correct, in_range;
+    Poly r = PolyFromString(input->text, 0, input->text.length - 1,
+                            &correct, &in_range);
+    if (!correct || !in_range)
+        exit(1);
+    PolyDestroy(&r);
+}
+
+/**
+ * Wszystkie benchmarki.
+ */
+static const Benchmark benchmarks[] = {
+    {"PolyAdd", BenchAdd},
+    {"PolyMul", BenchMul},
+    {"PolyPower", BenchPower},
+    {"PolyCompose", BenchCompose},
+    {"PolyAt", BenchAt},
+    {"PolyIsEq", BenchIsEq},
+    {"PolyFromString", BenchFromString},
+};
+
+/**
+ * Porównuje czasy, dla funkcji qsort.
+ * @param[in] a : wskaźnik na czas
+ * @param[in] b : wskaźnik na czas
+ * @return wynik porównania
+ */
+static int TimeComparator(const void *a, const void *b) {
+    long long x = *(const long long *) a, y = *(const long long *) b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Przygotowuje dane dla benchmarków o zadanym kształcie.
+ * @param[in] shape : parametry wielomianów
+ * @return dane
+ */
+static BenchInput InputInit(const PolyShape *shape) {
+    BenchInput input;
+    input.p = RandomPoly(shape, shape->depth);
+    input.q = RandomPoly(shape, shape->depth);
+
+    // podstawiamy małe wielomiany, żeby wynik nie rósł wykładniczo
+    PolyShape small = *shape;
+    small.terms = 2;
+    small.sparsity = 1;
+    input.arg_count = (size_t) shape->depth;
+    input.args = malloc((input.arg_count + 1) * sizeof(Poly));
+    if (input.args == NULL)
+        exit(1);
+    for (size_t i = 0; i < input.arg_count; i++) {
+        input.args[i] = RandomPoly(&small, 1);
+    }
+
+    input.text = StringInit();
+    PolyToString(&input.text, &input.p);
+    Append(&input.text, "\n");
+    return input;
+}
+
+/**
+ * Usuwa dane benchmarków z pamięci.
+ * @param[in] input : dane
+ */
+static void InputDestroy(BenchInput *input) {
+    PolyDestroy(&input->p);
+    PolyDestroy(&input->q);
+    for (size_t i = 0; i < input->arg_count; i++) {
+        PolyDestroy(&input->args[i]);
+    }
+    free(input->args);
+    free(input->text.A);
+}
+
+/**
+ * Uruchamia benchmark i wypisuje jego wynik.
+ * @param[in] bench : benchmark
+ * @param[in] shape : parametry wielomianów
+ * @param[in] input : dane
+ * @param[in] warmup : liczba uruchomień rozgrzewających
+ * @param[in] reps : liczba mierzonych uruchomień
+ * @param[in] json : czy wypisywać w formacie JSON
+ * @param[in] first : czy to pierwszy wypisywany wynik
+ */
+static void RunBenchmark(const Benchmark *bench, const PolyShape *shape,
+                         const BenchInput *input, long warmup, long reps,
+                         bool json, bool first) {
+    long long *times = malloc((size_t) reps * sizeof(long long));
+    if (times == NULL)
+        exit(1);
+
+    for (long i = 0; i < warmup; i++) {
+        bench->run(input);
+    }
+    long long total = 0;
+    MemoryStats before = GetMemoryStats();
+    for (long i = 0; i < reps; i++) {
+        long long start = NowNs();
+        bench->run(input);
+        times[i] = NowNs() - start;
+        total += times[i];
+    }
+    MemoryStats after = GetMemoryStats();
+    unsigned long long allocs = (after.allocs - before.allocs +
+                                 after.reallocs - before.reallocs) /
+                                (unsigned long long) reps;
+    qsort(times, (size_t) reps, sizeof(long long), TimeComparator);
+
+    const char *format = json ?
+        "%s\n  {\"benchmark\": \"%s\", \"terms\": %ld, \"depth\": %ld, "
+        "\"sparsity\": %ld, \"coeff_bits\": %ld, \"reps\": %ld, "
+        "\"min_ns\": %lld, \"median_ns\": %lld, \"mean_ns\": %lld, "
+        "\"allocs\": %llu}" :
+        "%s%s,%ld,%ld,%ld,%ld,%ld,%lld,%lld,%lld,%llu\n";
+    printf(format, json ? (first ? "" : ",") : "", bench->name,
+           shape->terms, shape->depth, shape->sparsity, shape->coeff_bits,
+           reps, times[0], times[reps / 2], total / reps, allocs);
+    free(times);
+}
+
+/**
+ * Parsuje listę liczb oddzielonych przecinkami.
+ * @param[in] s : napis
+ * @param[in] min : najmniejsza dopuszczalna wartość
+ * @param[in] max : największa dopuszczalna wartość
+ * @param[out] list : lista wartości
+ * @return czy napis jest poprawny
+ */
+static bool ParseList(const char *s, long min, long max, ParamList *list) {
+    list->count = 0;
+    while (list->count < MAX_PARAM_VALUES) {
+        char *end;
+        long value = strtol(s, &end, 10);
+        if (end == s || value < min || value > max)
+            return false;
+        list->values[list->count++] = value;
+        if (*end == '\0')
+            return true;
+        if (*end != ',')
+            return false;
+        s = end + 1;
+    }
+    return false;
+}
+
+/**
+ * Wypisuje sposób użycia programu.
+ * @param[in] program : nazwa programu
+ * @return 1 - kod wyjścia programu
+ */
+static int Usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [--terms N,...] [--depth N,...] [--sparsity N,...]\n"
+            "          [--coeff-bits N,...] [--reps N] [--warmup N]\n"
+            "          [--seed N] [--filter NAME] [--format csv|json]\n",
+            program);
+    return 1;
+}
+
+/**
+ * Funkcja main benchmarków.
+ * @param[in] argc : liczba argumentów
+ * @param[in] argv : argumenty
+ * @return 0, jeśli program zakończył się poprawnie, 1 w.p.p.
+ */
+int main(int argc, char *argv[]) {
+    ParamList terms = {{10}, 1}, depth = {{2}, 1};
+    ParamList sparsity = {{1}, 1}, coeff_bits = {{16}, 1};
+    ParamList reps = {{10}, 1}, warmup = {{2}, 1}, seed = {{1}, 1};
+    const char *filter = NULL;
+    bool json = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char *option = argv[i];
+        if (i + 1 == argc)
+            return Usage(argv[0]);
+        const char *value = argv[++i];
+        bool ok;
+        if (strcmp(option, "--terms") == 0) {
+            ok = ParseList(value, 1, 1000000, &terms);
+        } else if (strcmp(option, "--depth") == 0) {
+            ok = ParseList(value, 0, 64, &depth);
+        } else if (strcmp(option, "--sparsity") == 0) {
+            ok = ParseList(value, 1, 1000000, &sparsity);
+        } else if (strcmp(option, "--coeff-bits") == 0) {
+            ok = ParseList(value, 1, 62, &coeff_bits);
+        } else if (strcmp(option, "--reps") == 0) {
+            ok = ParseList(value, 1, 1000000, &reps) && reps.count == 1;
+        } else if (strcmp(option, "--warmup") == 0) {
+            ok = ParseList(value, 0, 1000000, &warmup) && warmup.count == 1;
+        } else if (strcmp(option, "--seed") == 0) {
+            ok = ParseList(value, 0, 2147483647, &seed) && seed.count == 1;
+        } else if (strcmp(option, "--filter") == 0) {
+            filter = value;
+        } else if (strcmp(option, "--format") == 0) {
+            json = strcmp(value, "json") == 0;
+            ok = json || strcmp(value, "csv") == 0;
+        } else {
+            ok = false;
+        }
+        if (!ok)
+            return Usage(argv[0]);
+    }
+
+    if (json) {
+        printf("[");
+    } else {
+        printf("benchmark,terms,depth,sparsity,coeff_bits,reps,"
+               "min_ns,median_ns,mean_ns,allocs\n");
+    }
+    bool first = true;
+    for (size_t a = 0; a < terms.count; a++)
+    for (size_t b = 0; b < depth.count; b++)
+    for (size_t c = 0; c < sparsity.count; c++)
+    for (size_t d = 0; d < coeff_bits.count; d++) {
+        PolyShape shape = {terms.values[a], depth.values[b],
+                           sparsity.values[c], coeff_bits.values[d]};
+        if (shape.terms * shape.sparsity > 2147483647L)
+            return Usage(argv[0]); // wykładniki nie zmieszczą się w typie
+        rng_state = (unsigned long long) seed.values[0];
+        BenchInput input = InputInit(&shape);
+
+        size_t count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+        for (size_t i = 0; i < count; i++) {
+            if (filter != NULL && strstr(benchmarks[i].name, filter) == NULL)
+                continue;
+            RunBenchmark(&benchmarks[i], &shape, &input, warmup.values[0],
+                         reps.values[0], json, first);
+            first = false;
+        }
+        InputDestroy(&input);
+    }
+    if (json)
+        printf("\n]\n");
+    return 0;
+}
@@ -3,10 +3,20 @@
 #endif
 
 #include "poly.h"
+#include "mallocs.h"
+#include "libpoly.h"
+#include "binary_io.h"
+#include "input_output.h"
 #include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <setjmp.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define CHECK_PTR(p)  \
   do {                \
@@ -15,7 +25,24 @@
     }                 \
   } while (0)
 
-#define C PolyFromCoeff
+#define C(x) PolyFromCoeff(CoeffFromWord(x))
+
+// w wariancie domyślnym współczynniki są typu long i działania na nich
+// są wykonywane modulo 2^64; pozostałe warianty mają własne testy
+#if !defined(POLY_COEFF_INT128) && !defined(POLY_COEFF_MOD) && \
+    !defined(POLY_COEFF_BIG)
+#define WRAPPING_LONG_COEFF
+#endif
+
+// LibPolyTest sprawdza obsługę nieudanej alokacji, więc sanitizery muszą
+// zwracać NULL zamiast przerywać program
+const char *__asan_default_options(void) {
+  return "allocator_may_return_null=1";
+}
+
+const char *__tsan_default_options(void) {
+  return "allocator_may_return_null=1";
+}
 
 static Mono M(Poly p, poly_exp_t n) {
   return MonoFromPoly(&p, n);
@@ -97,8 +124,10 @@ static bool TestEq(Poly a, Poly b, bool res) {
   return is_eq;
 }
 
-static bool TestAt(Poly a, poly_coeff_t x, Poly res) {
-  Poly b = PolyAt(&a, x);
+static bool TestAt(Poly a, poly_coeff_word_t x, Poly res) {
+  poly_coeff_t coeff = CoeffFromWord(x);
+  Poly b = PolyAt(&a, coeff);
+  CoeffDestroy(coeff);
   bool is_eq = PolyIsEq(&b, &res);
   PolyDestroy(&a);
   PolyDestroy(&b);
@@ -209,6 +238,53 @@ static bool SimpleAddMonosTest(void) {
   return res;
 }
 
+static bool LargeAddMonosTest(void) {
+  // wykładniki zajmują kilka cyfr sortowania pozycyjnego, a każdy
+  // występuje dwa razy, w przemieszanej kolejności
+  const size_t distinct = 2500;
+  const poly_exp_t stride = 65537;
+  Mono *monos = calloc(2 * distinct, sizeof(Mono));
+  CHECK_PTR(monos);
+  for (size_t i = 0; i < 2 * distinct; i++) {
+    poly_exp_t k = (poly_exp_t) (i * 7919 % distinct);
+    monos[i] = M(C(1), k * stride);
+  }
+  Poly p = PolyAddMonos(2 * distinct, monos);
+  free(monos);
+
+  bool res = !PolyIsCoeff(&p) && p.size == distinct;
+  for (size_t k = 0; res && k < distinct; k++) {
+    Poly two = C(2);
+    res = MonoGetExp(&p.arr[k]) == (poly_exp_t) k * stride &&
+          PolyIsEq(&p.arr[k].p, &two);
+  }
+  PolyDestroy(&p);
+  return res;
+}
+
+static bool SameExpAddMonosTest(void) {
+  // wszystkie jednomiany mają ten sam wykładnik, a współczynniki
+  // są na przemian stałymi i wielomianami
+  const size_t count = 3000;
+  Mono *monos = calloc(count, sizeof(Mono));
+  CHECK_PTR(monos);
+  for (size_t i = 0; i < count; i++) {
+    if (i % 2 == 0)
+      monos[i] = M(C(2), 5);
+    else
+      monos[i] = M(P(C(1), (poly_exp_t) (1 + i % 3)), 5);
+  }
+  bool res = TestAddMonos(count, monos,
+                          P(P(C(3000), 0, C(500), 1, C(500), 2, C(500), 3),
+                            5));
+  free(monos);
+
+  Mono cancel[] = {M(P(C(1), 1), 2), M(C(3), 2), M(P(C(-1), 1), 2),
+                   M(C(-3), 2), M(C(1), 0)};
+  res &= TestAddMonos(5, cancel, C(1));
+  return res;
+}
+
 static bool SimpleMulTest(void) {
   bool res = true;
   res &= TestMul(C(2),
@@ -300,6 +376,7 @@ static bool SimpleAtTest(void) {
   return res;
 }
 
+#ifdef WRAPPING_LONG_COEFF
 static bool OverflowTest(void) {
   bool res = true;
   res &= TestMul(P(C(1L << 32), 1), C(1L << 32), C(0));
@@ -308,10 +385,573 @@ static bool OverflowTest(void) {
   res &= TestAt(P(P(C(1), 1), 64), 2, C(0));
   return res;
 }
+#endif
+
+static bool MemoryStatsTest(void) {
+  MemoryStats before = GetMemoryStats();
+  Poly a = P(P(C(1), 1, C(2), 3), 0, C(4), 2);
+  Poly b = P(C(-1), 1, P(C(5), 2), 4);
+  Poly c = PolyMul(&a, &b);
+  Poly d = PolyAdd(&c, &a);
+  MemoryStats during = GetMemoryStats();
+  PolyDestroy(&a);
+  PolyDestroy(&b);
+  PolyDestroy(&c);
+  PolyDestroy(&d);
+  MemoryStats after = GetMemoryStats();
+
+  bool res = true;
+  res &= during.live_bytes > before.live_bytes;
+  res &= during.peak_bytes >= during.live_bytes;
+  res &= during.allocs > before.allocs;
+  res &= after.live_bytes == before.live_bytes;
+  res &= after.frees > during.frees;
+  return res;
+}
+
+static bool LibPolyTest(void) {
+  bool res = true;
+  const char *text = "(1,0)+((2,1)+(-3,2),4)";
+#ifdef POLY_COEFF_MOD
+  const char *printed = "(1,0)+((2,1)+(2305843009213693948,2),4)";
+#else
+  const char *printed = text;
+#endif
+  Poly p, q = C(7);
+  res &= PolyLibFromString(text, strlen(text), &p) == POLY_OK;
+
+  char *out;
+  size_t length;
+  res &= PolyLibToString(&p, &out, &length) == POLY_OK;
+  res &= length == strlen(printed) && strcmp(out, printed) == 0;
+  free(out);
+
+  Poly sum, two = C(2);
+  res &= PolyLibAdd(&p, &p, &sum) == POLY_OK;
+  Poly doubled = PolyMul(&p, &two);
+  res &= PolyIsEq(&sum, &doubled);
+  PolyDestroy(&sum);
+  PolyDestroy(&doubled);
+
+  res &= PolyLibFromString("(1,2", 4, &q) == POLY_ERROR_SYNTAX;
+#ifndef POLY_COEFF_BIG
+  const char *huge = "1000000000000000000000000000000000000000";
+  res &= PolyLibFromString(huge, strlen(huge), &q) == POLY_ERROR_RANGE;
+#endif
+  res &= PolyLibFromString("(1,2147483648)", 14, &q) == POLY_ERROR_RANGE;
+  res &= PolyIsCoeff(&q) && CoeffEq(q.coeff, CoeffFromWord(7));
+
+  // nieudana alokacja nie kończy programu, a wynik pozostaje niezmieniony
+  Mono mono = M(C(1), 1);
+  res &= PolyLibAddMonos(SIZE_MAX / sizeof(Mono) / 2, &mono, &q)
+         == POLY_ERROR_NO_MEMORY;
+  res &= PolyIsCoeff(&q) && CoeffEq(q.coeff, CoeffFromWord(7));
+
+  PolyStack stack;
+  Poly top;
+  res &= PolyLibStackInit(&stack) == POLY_OK;
+  res &= PolyLibStackPop(&stack, &top) == POLY_ERROR_STACK_UNDERFLOW;
+  for (int i = 0; i < 2 * INITIAL_STACK_SIZE; i++)
+    res &= PolyLibStackPush(&stack, C(i)) == POLY_OK;
+  res &= PolyLibStackPush(&stack, p) == POLY_OK;
+  res &= PolyLibStackPop(&stack, &top) == POLY_OK;
+  res &= PolyIsEq(&top, &p);
+  res &= PolyLibStackPop(&stack, &top) == POLY_OK;
+  res &= PolyIsCoeff(&top) &&
+         CoeffEq(top.coeff, CoeffFromWord(2 * INITIAL_STACK_SIZE - 1));
+  PolyLibStackClear(&stack);
+  PolyDestroy(&p);
+  return res;
+}
+
+// operacja wykonana z coraz większym budżetem pamięci kończy się brakiem
+// pamięci, dopóki budżet nie wystarczy, i nie zostawia przy tym żadnej
+// zaalokowanej pamięci
+#define TEST_OUT_OF_MEMORY(res, call, result_destroy)                     \
+  do {                                                                    \
+    long long before = GetMemoryStats().live_bytes;                       \
+    PolyError error = POLY_ERROR_NO_MEMORY;                               \
+    for (long long limit = 0; error == POLY_ERROR_NO_MEMORY; limit += 8) { \
+      MemoryBudget budget = {.live_bytes = 0, .limit = limit};            \
+      MemoryBudget *previous = SetMemoryBudget(&budget);                  \
+      error = (call);                                                     \
+      SetMemoryBudget(previous);                                          \
+      if (error == POLY_ERROR_NO_MEMORY)                                  \
+        res &= budget.live_bytes == 0 &&                                  \
+               GetMemoryStats().live_bytes == before;                     \
+    }                                                                     \
+    res &= error == POLY_OK;                                              \
+    result_destroy;                                                       \
+  } while (0)
+
+// nieudana alokacja w zagnieżdżonym obszarze nie zwalnia pamięci
+// zaalokowanej wcześniej w obszarze zewnętrznym
+static bool NestedOutOfMemoryTest(const Poly *a, const Poly *b) {
+  AllocationGuard guard;
+  BeginAllocationGuard(&guard);
+  if (setjmp(guard.handler) != 0)
+    return false;
+  Poly outer = PolyMul(a, b), r;
+  MemoryBudget budget = {.live_bytes = 0, .limit = 0};
+  MemoryBudget *previous = SetMemoryBudget(&budget);
+  bool failed = PolyLibMul(a, b, &r) == POLY_ERROR_NO_MEMORY;
+  SetMemoryBudget(previous);
+  EndAllocationGuard(&guard);
+
+  bool res = failed && PolyLibMul(a, b, &r) == POLY_OK && PolyIsEq(&outer, &r);
+  PolyDestroy(&r);
+  PolyDestroy(&outer);
+  return res;
+}
+
+static bool OutOfMemoryTest(void) {
+  bool res = true;
+  Poly a = P(P(C(1), 1, C(2), 3), 0, C(4), 2,
+             P(C(-1), 1, P(C(5), 2, C(6), 7), 4), 5);
+  Poly b = P(C(3), 0, P(C(-2), 1, C(1), 3), 2);
+  Poly q[] = {b, P(C(1), 1)};
+  char *text, *out;
+  size_t length;
+  Poly r;
+  res &= PolyLibToString(&a, &text, &length) == POLY_OK;
+
+  TEST_OUT_OF_MEMORY(res, PolyLibMul(&a, &b, &r), PolyDestroy(&r));
+  TEST_OUT_OF_MEMORY(res, PolyLibAdd(&a, &b, &r), PolyDestroy(&r));
+  TEST_OUT_OF_MEMORY(res, PolyLibPower(&b, 3, &r), PolyDestroy(&r));
+  TEST_OUT_OF_MEMORY(res, PolyLibCompose(&a, 2, q, &r), PolyDestroy(&r));
+  TEST_OUT_OF_MEMORY(res, PolyLibFromString(text, length, &r),
+                     PolyDestroy(&r));
+  TEST_OUT_OF_MEMORY(res, PolyLibToString(&a, &out, NULL), free(out));
+
+  res &= NestedOutOfMemoryTest(&a, &b);
+
+  free(text);
+  PolyDestroy(&a);
+  PolyDestroy(&b);
+  PolyDestroy(&q[1]);
+  return res;
+}
+
+static bool TestParse(const char *text, PolyError expected,
+                      const char *printed) {
+  Poly p;
+  PolyError error = PolyLibFromString(text, strlen(text), &p);
+  if (error != expected)
+    return false;
+  if (error != POLY_OK)
+    return true;
+
+  char *out;
+  size_t length;
+  bool res = PolyLibToString(&p, &out, &length) == POLY_OK &&
+             length == strlen(printed) && memcmp(out, printed, length) == 0;
+  free(out);
+  PolyDestroy(&p);
+  return res;
+}
+
+static bool ParserTest(void) {
+  bool res = true;
+  // niepoprawne użycie znaku +
+  res &= TestParse("+(1,2)", POLY_ERROR_SYNTAX, NULL);
+  res &= TestParse("(1,2)+", POLY_ERROR_SYNTAX, NULL);
+  res &= TestParse("(1,2)++(1,3)", POLY_ERROR_SYNTAX, NULL);
+  res &= TestParse("((1,2)+,3)", POLY_ERROR_SYNTAX, NULL);
+  res &= TestParse("1+", POLY_ERROR_SYNTAX, NULL);
+  res &= TestParse("", POLY_ERROR_SYNTAX, NULL);
+  res &= TestParse("(1,2", POLY_ERROR_SYNTAX, NULL);
+  res &= TestParse("(1,2))", POLY_ERROR_SYNTAX, NULL);
+  res &= TestParse("(1,-2)", POLY_ERROR_SYNTAX, NULL);
+
+  // zakres wykładników
+  res &= TestParse("(1,2147483647)", POLY_OK, "(1,2147483647)");
+  res &= TestParse("(1,2147483648)", POLY_ERROR_RANGE, NULL);
+  res &= TestParse("(1,4294967297)", POLY_ERROR_RANGE, NULL);
+
+#ifdef WRAPPING_LONG_COEFF
+  // zakres współczynników
+  res &= TestParse("-9223372036854775808", POLY_OK, "-9223372036854775808");
+  res &= TestParse("(-9223372036854775808,1)", POLY_OK,
+                   "(-9223372036854775808,1)");
+  res &= TestParse("9223372036854775807", POLY_OK, "9223372036854775807");
+  res &= TestParse("9223372036854775808", POLY_ERROR_RANGE, NULL);
+  res &= TestParse("-9223372036854775809", POLY_ERROR_RANGE, NULL);
+#endif
+
+  // jednomiany posortowane i nieposortowane, sumowanie i zera
+  res &= TestParse("(3,1)+(1,2)", POLY_OK, "(3,1)+(1,2)");
+  res &= TestParse("(1,2)+(3,1)", POLY_OK, "(3,1)+(1,2)");
+  res &= TestParse("(1,5)+(2,0)+(3,3)", POLY_OK, "(2,0)+(3,3)+(1,5)");
+  res &= TestParse("(1,1)+(2,1)", POLY_OK, "(3,1)");
+  res &= TestParse("(1,1)+(-1,1)", POLY_OK, "0");
+  res &= TestParse("(0,5)", POLY_OK, "0");
+  res &= TestParse("((1,0),0)", POLY_OK, "1");
+  res &= TestParse("((1,2)+(1,1),3)+(2,3)", POLY_OK,
+                   "((2,0)+(1,1)+(1,2),3)");
+
+  // głębokie zagnieżdżenie
+  const size_t depth = 1000;
+  char *deep = malloc(12 * depth + 2);
+  CHECK_PTR(deep);
+  size_t length = 0;
+  for (size_t i = 0; i < depth; i++)
+    deep[length++] = '(';
+  deep[length++] = '7';
+  for (size_t i = 0; i < depth; i++)
+    length += (size_t) sprintf(deep + length, ",%zu)", i % 3 + 1);
+  deep[length] = '\0';
+  res &= TestParse(deep, POLY_OK, deep);
+  deep[length - 1] = '\0';
+  res &= TestParse(deep, POLY_ERROR_SYNTAX, NULL);
+  free(deep);
+  return res;
+}
+
+#ifdef POLY_COEFF_INT128
+static bool Int128CoeffTest(void) {
+  bool res = true;
+  const poly_coeff_word_t two_62 = (poly_coeff_word_t) 1 << 62;
+  const poly_coeff_word_t max = -(POLY_COEFF_MIN + 1);
+  // iloczyny i wartości większe niż 2^63
+  res &= TestMul(C(two_62), C(two_62), C(two_62 << 62));
+  res &= TestMul(P(C(LONG_MAX), 1), C(LONG_MAX),
+                 P(C((poly_coeff_word_t) LONG_MAX * LONG_MAX), 1));
+  res &= TestAdd(C(LONG_MAX), C(1), C((poly_coeff_word_t) 1 << 63));
+  res &= TestAt(P(C(1), 64), 2, C((poly_coeff_word_t) 1 << 64));
+  res &= TestAt(P(C(1), 100), 2, C((poly_coeff_word_t) 1 << 100));
+  // działania modulo 2^128
+  res &= TestAdd(C(max), C(1), C(POLY_COEFF_MIN));
+  res &= TestMul(C(two_62 << 62), C(16), C(0));
+  res &= TestAt(P(C(1), 0, C(1), 128), 2, C(1));
+
+  // parsowanie i wypisywanie liczb spoza zakresu typu long
+  res &= TestParse("9223372036854775808", POLY_OK, "9223372036854775808");
+  res &= TestParse("(-9223372036854775809,1)", POLY_OK,
+                   "(-9223372036854775809,1)");
+  res &= TestParse("(4611686018427387904,1)+(4611686018427387904,1)",
+                   POLY_OK, "(9223372036854775808,1)");
+  res &= TestParse("21267647932558653966460912964485513216", POLY_OK,
+                   "21267647932558653966460912964485513216");
+  res &= TestParse("170141183460469231731687303715884105727", POLY_OK,
+                   "170141183460469231731687303715884105727");
+  res &= TestParse("-170141183460469231731687303715884105728", POLY_OK,
+                   "-170141183460469231731687303715884105728");
+  res &= TestParse("170141183460469231731687303715884105728",
+                   POLY_ERROR_RANGE, NULL);
+  res &= TestParse("-170141183460469231731687303715884105729",
+                   POLY_ERROR_RANGE, NULL);
+
+  Poly p = C(two_62), q = C(two_62), product;
+  char *out;
+  res &= PolyLibMul(&p, &q, &product) == POLY_OK;
+  res &= PolyLibToString(&product, &out, NULL) == POLY_OK &&
+         strcmp(out, "21267647932558653966460912964485513216") == 0;
+  free(out);
+  PolyDestroy(&product);
+  return res;
+}
+#endif
+
+#ifdef POLY_COEFF_MOD
+_Static_assert(POLY_COEFF_MODULUS == (1L << 61) - 1,
+               "ModCoeffTest assumes the default modulus 2^61 - 1");
+
+static bool ModCoeffTest(void) {
+  bool res = true;
+  const poly_coeff_word_t m = POLY_COEFF_MODULUS;
+  // reszty z dzielenia przez 2^61 - 1
+  res &= TestEq(C(m), C(0), true);
+  res &= TestEq(C(-1), C(m - 1), true);
+  res &= TestAdd(C(m - 1), C(5), C(4));
+  res &= TestSub(C(2), C(5), C(m - 3));
+  res &= TestMul(C(m - 1), C(m - 1), C(1));
+  res &= TestMul(C(1L << 40), C(1L << 40), C(1L << 19));
+  res &= TestMul(P(C(1L << 60), 1), C(4), P(C(2), 1));
+  res &= TestAt(P(C(1), 61), 2, C(1));
+  res &= TestAt(P(C(1), 0, C(1), 64), 2, C(9));
+  res &= TestAt(P(C(1), 2), m - 1, C(1));
+  res &= TestAdd(P(C(m - 1), 1), P(C(1), 1), C(0));
+
+  // wczytane liczby są sprowadzane do reszt
+  res &= TestParse("2305843009213693951", POLY_OK, "0");
+  res &= TestParse("-1", POLY_OK, "2305843009213693950");
+  res &= TestParse("9223372036854775807", POLY_OK, "3");
+  res &= TestParse("-9223372036854775808", POLY_OK, "2305843009213693947");
+  res &= TestParse("(2305843009213693950,1)+(2,1)", POLY_OK, "(1,1)");
+  res &= TestParse("(2305843009213693951,1)", POLY_OK, "0");
+  res &= TestParse("9223372036854775808", POLY_ERROR_RANGE, NULL);
+  return res;
+}
+#endif
+
+#ifdef POLY_COEFF_BIG
+static poly_coeff_t Big(const char *text) {
+  bool negative = text[0] == '-';
+  const char *digits = text + negative;
+  return BigCoeffFromDigits(digits, strlen(digits), negative);
+}
+
+#define B(text) PolyFromCoeff(Big(text))
+
+// sprawdza, czy wynik jest małym współczynnikiem x, i zwalnia go
+static bool TestSmall(poly_coeff_t c, long x) {
+  bool res = c.big == NULL && c.small == x;
+  CoeffDestroy(c);
+  return res;
+}
+
+static bool BigCoeffTest(void) {
+  bool res = true;
+  MemoryStats before = GetMemoryStats();
+
+  // LONG_MAX + 1 i LONG_MIN - 1 przestają mieścić się w typie long
+  poly_coeff_t c = CoeffAdd(CoeffFromWord(LONG_MAX), CoeffFromWord(1));
+  res &= c.big != NULL;
+  CoeffDestroy(c);
+  res &= TestAdd(C(LONG_MAX), C(1), B("9223372036854775808"));
+  res &= TestSub(C(LONG_MIN), C(1), B("-9223372036854775809"));
+  res &= TestSub(C(0), C(LONG_MIN), B("9223372036854775808"));
+  res &= TestMul(C(LONG_MIN), C(-1), B("9223372036854775808"));
+  res &= TestAt(P(C(1), 64), 2, B("18446744073709551616"));
+
+  // przeniesienie przez granice cyfr o podstawie 2^32
+  res &= TestAdd(C(LONG_MAX), C(LONG_MAX), B("18446744073709551614"));
+  res &= TestAdd(B("18446744073709551615"), C(1), B("18446744073709551616"));
+  res &= TestAdd(B("79228162514264337593543950335"), C(1),
+                 B("79228162514264337593543950336"));
+  res &= TestMul(B("18446744073709551615"), B("18446744073709551615"),
+                 B("340282366920938463426481119284349108225"));
+
+  // pożyczka przez granice cyfr, aż do zera
+  res &= TestSub(B("18446744073709551616"), C(1), B("18446744073709551615"));
+  res &= TestAdd(B("79228162514264337593543950336"), C(-1),
+                 B("79228162514264337593543950335"));
+  res &= TestSub(B("18446744073709551616"), B("18446744073709551615"), C(1));
+  res &= TestSub(B("18446744073709551616"), B("18446744073709551616"), C(0));
+  poly_coeff_t x = Big("-18446744073709551616");
+  poly_coeff_t y = Big("18446744073709551616");
+  c = CoeffAdd(x, y);
+  res &= CoeffIsZero(c) && TestSmall(c, 0);
+  CoeffDestroy(x);
+  CoeffDestroy(y);
+
+  // wynik wraca do typu long, także dokładnie do LONG_MIN
+  x = Big("-9223372036854775809");
+  res &= TestSmall(CoeffAdd(x, CoeffFromWord(1)), LONG_MIN);
+  CoeffDestroy(x);
+  x = Big("9223372036854775808");
+  res &= TestSmall(CoeffNeg(x), LONG_MIN);
+  res &= TestSmall(CoeffAdd(x, CoeffFromWord(-1)), LONG_MAX);
+  CoeffDestroy(x);
+  res &= TestSmall(Big("-9223372036854775808"), LONG_MIN);
+  res &= TestAdd(B("-9223372036854775809"), C(1), C(LONG_MIN));
+  res &= TestMul(B("4611686018427387904"), C(-2), C(LONG_MIN));
+
+  // parsowanie i wypisywanie liczb 40-cyfrowych
+  res &= TestParse("1234567890123456789012345678901234567890", POLY_OK,
+                   "1234567890123456789012345678901234567890");
+  res &= TestParse("-1000000000000000000000000000000000000000", POLY_OK,
+                   "-1000000000000000000000000000000000000000");
+  res &= TestParse("(1000000000000000000000000000000000000001,1)+(1,2)",
+                   POLY_OK,
+                   "(1000000000000000000000000000000000000001,1)+(1,2)");
+  res &= TestParse("(9999999999999999999999999999999999999999,1)+(1,1)",
+                   POLY_OK, "(10000000000000000000000000000000000000000,1)");
+  res &= TestParse("(1000000000000000000000000000000000000000,1)+"
+                   "(-1000000000000000000000000000000000000000,1)",
+                   POLY_OK, "0");
+  res &= TestParse("-9223372036854775809", POLY_OK, "-9223372036854775809");
+
+  Poly p = B("12345678901234567890"), q = B("98765432109876543210");
+  Poly product;
+  char *out;
+  res &= PolyLibMul(&p, &q, &product) == POLY_OK;
+  res &= PolyLibToString(&product, &out, NULL) == POLY_OK &&
+         strcmp(out, "1219326311370217952237463801111263526900") == 0;
+  free(out);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&product);
+
+  res &= GetMemoryStats().live_bytes == before.live_bytes;
+  return res;
+}
+#endif
+
+// rekord kopiujemy do bufora dokładnie jego długości, żeby sanitizer
+// wykrył odczyt poza rekordem
+static bool TestBinary(const char *record, size_t length, bool expected) {
+  char *copy = malloc(length);
+  CHECK_PTR(copy);
+  memcpy(copy, record, length);
+  StringWithSize str = {.A = copy, .length = length, .size = length};
+  bool correct, in_range;
+  Poly p = PolyFromBinary(str, &correct, &in_range);
+  free(copy);
+  PolyDestroy(&p);
+  return (correct && in_range) == expected;
+}
+
+static bool TestBinaryRoundTrip(Poly p) {
+  StringWithSize record = PolyToBinary(&p);
+  bool correct, in_range;
+  Poly q = PolyFromBinary(record, &correct, &in_range);
+  bool res = correct && in_range && PolyIsEq(&p, &q) &&
+             TestBinary(record.A, record.length, true);
+  StringFree(&record);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  return res;
+}
+
+static bool BinaryIoTest(void) {
+  bool res = true;
+  // zagnieżdżone wielomiany, ujemne współczynniki, duże wykładniki
+  res &= TestBinaryRoundTrip(C(0));
+  res &= TestBinaryRoundTrip(C(-5));
+  res &= TestBinaryRoundTrip(P(C(1), 0, C(-3), 5));
+  res &= TestBinaryRoundTrip(
+      P(P(C(1), 0, P(C(-2), 3, C(4), 7), 1), 2, C(9), 4,
+        P(C(-1), 2147483647), 2147483647));
+
+  // zigzag dla skrajnych współczynników
+  res &= TestBinaryRoundTrip(C(LONG_MIN));
+  res &= TestBinaryRoundTrip(C(LONG_MAX));
+  res &= TestBinaryRoundTrip(P(C(LONG_MIN), 1, C(LONG_MAX), 2));
+#ifdef WRAPPING_LONG_COEFF
+  // LONG_MIN to zigzag 2^64 - 1, czyli najdłuższy varint
+  const char long_min[] = "\x01\x0b\x00\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01";
+  res &= TestBinary(long_min, sizeof(long_min) - 1, true);
+  StringWithSize str = {.A = (char *) long_min,
+                        .length = sizeof(long_min) - 1,
+                        .size = sizeof(long_min) - 1};
+  bool correct, in_range;
+  Poly decoded = PolyFromBinary(str, &correct, &in_range);
+  res &= correct && PolyIsCoeff(&decoded) && decoded.coeff == LONG_MIN;
+  PolyDestroy(&decoded);
+#endif
+#ifdef POLY_COEFF_BIG
+  // duże współczynniki: nagłówek 2n + znak i n cyfr o podstawie 2^32
+  res &= TestBinaryRoundTrip(B("1234567890123456789012345678901234567890"));
+  res &= TestBinaryRoundTrip(
+      P(B("-18446744073709551616"), 1, B("9223372036854775808"), 3));
+  const char two_64[] = "\x01\x05\x00\x06\x00\x00\x01";
+  res &= TestBinary(two_64, sizeof(two_64) - 1, true);
+  StringWithSize str = {.A = (char *) two_64,
+                        .length = sizeof(two_64) - 1,
+                        .size = sizeof(two_64) - 1};
+  bool correct, in_range;
+  Poly decoded = PolyFromBinary(str, &correct, &in_range);
+  res &= correct && TestEq(decoded, B("18446744073709551616"), true);
+  const char wide_limb[] = "\x01\x07\x00\x02\x80\x80\x80\x80\x10";
+  res &= TestBinary(wide_limb, sizeof(wide_limb) - 1, false);
+  const char few_limbs[] = "\x01\x04\x00\x06\x00\x00";
+  res &= TestBinary(few_limbs, sizeof(few_limbs) - 1, false);
+#endif
+
+  // każdy przycięty rekord, także z długością zgodną z przyciętą treścią
+  Poly p = P(P(C(1), 0, C(-3), 5), 2, C(LONG_MIN), 4);
+  StringWithSize record = PolyToBinary(&p);
+  PolyDestroy(&p);
+  for (size_t length = 1; length < record.length; length++)
+    res &= TestBinary(record.A, length, false);
+  for (size_t cut = 0; cut + 2 < record.length; cut++) {
+    char truncated[64] = {BINARY_RECORD_MARKER, (char) cut};
+    memcpy(truncated + 2, record.A + 2, cut);
+    res &= TestBinary(truncated, cut + 2, false);
+  }
+  StringFree(&record);
+
+  // za długie liczby varint w nagłówku i w treści
+  const char long_header[] =
+      "\x01\x82\x80\x80\x80\x80\x80\x80\x80\x80\x80\x00\x00\x00";
+  res &= TestBinary(long_header, sizeof(long_header) - 1, false);
+  const char long_count[] =
+      "\x01\x0b\x80\x80\x80\x80\x80\x80\x80\x80\x80\x80\x00";
+  res &= TestBinary(long_count, sizeof(long_count) - 1, false);
+  const char wide_coeff[] = "\x01\x0b\x00\xff\xff\xff\xff\xff\xff\xff\xff\xff\x02";
+  res &= TestBinary(wide_coeff, sizeof(wide_coeff) - 1, false);
+  const char open_varint[] = "\x01\x03\x00\x80\x80";
+  res &= TestBinary(open_varint, sizeof(open_varint) - 1, false);
+
+  // nadmiarowe bajty, zbyt wiele jednomianów i wykładnik poza zakresem
+  const char trailing[] = "\x01\x05\x00\x02\x00\x00\x00";
+  res &= TestBinary(trailing, sizeof(trailing) - 1, false);
+  const char many_monos[] = "\x01\x05\xff\xff\xff\xff\x0f";
+  res &= TestBinary(many_monos, sizeof(many_monos) - 1, false);
+  const char exp_range[] = "\x01\x08\x01\x80\x80\x80\x80\x10\x00\x02";
+  res &= TestBinary(exp_range, sizeof(exp_range) - 1, false);
+  return res;
+}
+
+#define READER_THREADS 4
+#define READER_ROUNDS 200
+
+typedef struct ReaderArgs {
+  const Poly *shared;
+  const Poly *expected_at;
+  const char *expected_text;
+  bool ok;
+} ReaderArgs;
+
+static void *ReaderThread(void *arg) {
+  ReaderArgs *args = arg;
+  args->ok = true;
+  for (int i = 0; i < READER_ROUNDS; i++) {
+    args->ok &= PolyDegBy(args->shared, 0) == 7;
+    args->ok &= PolyDegBy(args->shared, 1) == 3;
+    args->ok &= PolyDeg(args->shared) == 7;
+    args->ok &= PolyIsEq(args->shared, args->shared);
+
+    Poly at = PolyAt(args->shared, CoeffFromWord(2));
+    args->ok &= PolyIsEq(&at, args->expected_at);
+    PolyDestroy(&at);
+
+    StringWithSize text = StringInit();
+    PolyFormat(args->shared, &text);
+    args->ok &= text.length == strlen(args->expected_text) &&
+                memcmp(text.A, args->expected_text, text.length) == 0;
+    StringFree(&text);
+
+    Poly square = PolyMul(args->shared, args->shared);
+    Poly sum = PolyAdd(&square, args->shared);
+    args->ok &= PolyDeg(&sum) == 14;
+    PolyDestroy(&square);
+    PolyDestroy(&sum);
+  }
+  return NULL;
+}
+
+static bool ConcurrentReadersTest(void) {
+  Poly shared = P(C(-4), 0, P(C(2), 1, C(1), 3), 2, P(C(3), 1), 5, C(5), 7);
+  Poly expected_at = P(C(636), 0, C(104), 1, C(4), 3);
+  StringWithSize expected = StringInit();
+  PolyFormat(&shared, &expected);
+  StringAppend(&expected, "", 1);
+
+  pthread_t threads[READER_THREADS];
+  ReaderArgs args[READER_THREADS];
+  for (int i = 0; i < READER_THREADS; i++) {
+    args[i] = (ReaderArgs) {&shared, &expected_at, expected.A, false};
+    if (pthread_create(&threads[i], NULL, ReaderThread, &args[i]) != 0)
+      exit(1);
+  }
+  bool res = true;
+  for (int i = 0; i < READER_THREADS; i++) {
+    pthread_join(threads[i], NULL);
+    res &= args[i].ok;
+  }
+  StringFree(&expected);
+  PolyDestroy(&expected_at);
+  PolyDestroy(&shared);
+  return res;
+}
 
 int main() {
   assert(SimpleAddTest());
   assert(SimpleAddMonosTest());
+  assert(LargeAddMonosTest());
+  assert(SameExpAddMonosTest());
   assert(SimpleMulTest());
   assert(SimpleNegTest());
   assert(SimpleSubTest());
@@ -319,5 +959,19 @@ int main() {
   assert(SimpleDegTest());
   assert(SimpleIsEqTest());
   assert(SimpleAtTest());
+#ifdef POLY_COEFF_INT128
+  assert(Int128CoeffTest());
+#elif defined(POLY_COEFF_MOD)
+  assert(ModCoeffTest());
+#elif defined(POLY_COEFF_BIG)
+  assert(BigCoeffTest());
+#else
   assert(OverflowTest());
+#endif
+  assert(MemoryStatsTest());
+  assert(LibPolyTest());
+  assert(OutOfMemoryTest());
+  assert(ParserTest());
+  assert(BinaryIoTest());
+  assert(ConcurrentReadersTest());
 }
@@ -0,0 +1,514 @@
+/** @file
+  Test regresji przepustowości kalkulatora.
+
+  Program wykonuje kalkulatorem każdy skrypt X.in z katalogu korpusu,
+  sprawdza, czy standardowe wyjście i wyjście błędów są takie same jak
+  w plikach X.out i X.err, oraz mierzy liczbę wierszy na sekundę czasu
+  procesora i największe zużycie pamięci procesu. Krótkie skrypty są
+  w pomiarze powtarzane w jednym wejściu kalkulatora tyle razy, żeby
+  przebieg trwał co najmniej zadany czas, bo pomiar kilkumilisekundowego
+  procesu jest zdominowany przez jego uruchomienie i szum. Wyniki porównuje
+  z zapisanymi w pliku CSV wynikami bazowymi: przepustowość nie może spaść,
+  a zużycie pamięci wzrosnąć, o więcej niż zadaną tolerancję.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#define _DEFAULT_SOURCE
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+/**
+ * Maksymalna długość ścieżki tworzonej przez program.
+ */
+#define PATH_LENGTH 4096
+
+/**
+ * Maksymalna liczba skryptów w korpusie i wyników bazowych.
+ */
+#define MAX_SCRIPTS 256
+
+/**
+ * Maksymalna długość nazwy skryptu.
+ */
+#define NAME_LENGTH 256
+
+/**
+ * Ile razy najwyżej poprawiamy liczbę powtórzeń skryptu w przebiegu.
+ */
+#define CALIBRATION_ROUNDS 3
+
+/**
+ * To jest struktura przechowująca wynik pomiaru jednego skryptu.
+ */
+typedef struct ScriptResult {
+    char name[NAME_LENGTH]; ///< nazwa skryptu (bez rozszerzenia)
+    long lines; ///< liczba wierszy skryptu
+    long passes; ///< ile razy skrypt powtórzono w mierzonym przebiegu
+    double seconds; ///< najkrótszy czas procesora (użytkownika i systemu)
+    double wall_seconds; ///< najkrótszy czas rzeczywisty
+    double lines_per_sec; ///< przepustowość względem czasu procesora
+    long peak_rss_kb; ///< największe zużycie pamięci w KiB
+} ScriptResult;
+
+/**
+ * To jest struktura przechowująca opcje programu.
+ */
+typedef struct HarnessOptions {
+    const char *poly; ///< ścieżka kalkulatora
+    const char *corpus; ///< katalog korpusu
+    const char *baseline; ///< plik z wynikami bazowymi lub NULL
+    double tolerance; ///< dopuszczalny względny spadek wyników
+    long reps; ///< liczba powtórzeń każdego skryptu
+    double min_seconds; ///< najkrótszy czas procesora mierzonego przebiegu
+    bool update; ///< czy zapisać wyniki jako nowe wyniki bazowe
+} HarnessOptions;
+
+/**
+ * Zwraca aktualny czas w sekundach.
+ * @return czas
+ */
+static double Now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double) ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Sprawdza, czy napis kończy się podanym sufiksem.
+ * @param[in] s : napis
+ * @param[in] suffix : sufiks
+ * @return czy @p s kończy się @p suffix
+ */
+static bool EndsWith(const char *s, const char *suffix) {
+    size_t length = strlen(s), suffix_length = strlen(suffix);
+    return length >= suffix_length &&
+           strcmp(s + length - suffix_length, suffix) == 0;
+}
+
+/**
+ * Porównuje nazwy skryptów, dla funkcji qsort.
+ * @param[in] a : wskaźnik na wynik
+ * @param[in] b : wskaźnik na wynik
+ * @return wynik porównania
+ */
+static int NameComparator(const void *a, const void *b) {
+    return strcmp(((const ScriptResult *) a)->name,
+                  ((const ScriptResult *) b)->name);
+}
+
+/**
+ * Wyszukuje w korpusie skrypty (pliki z rozszerzeniem .in).
+ * @param[in] corpus : katalog korpusu
+ * @param[out] scripts : skrypty, posortowane po nazwie
+ * @return liczba skryptów lub -1, jeśli nie udało się odczytać katalogu
+ */
+static int ListScripts(const char *corpus, ScriptResult scripts[]) {
+    DIR *dir = opendir(corpus);
+    if (dir == NULL)
+        return -1;
+
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && count < MAX_SCRIPTS) {
+        size_t length = strlen(entry->d_name);
+        if (entry->d_name[0] == '.' || !EndsWith(entry->d_name, ".in") ||
+            length - 3 >= NAME_LENGTH)
+            continue;
+        memset(&scripts[count], 0, sizeof(ScriptResult));
+        memcpy(scripts[count].name, entry->d_name, length - 3);
+        count++;
+    }
+    closedir(dir);
+    qsort(scripts, (size_t) count, sizeof(ScriptResult), NameComparator);
+    return count;
+}
+
+/**
+ * Liczy wiersze pliku.
+ * @param[in] path : ścieżka pliku
+ * @return liczba wierszy lub -1, jeśli nie udało się odczytać pliku
+ */
+static long CountLines(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return -1;
+    long lines = 0;
+    int c;
+    while ((c = getc(file)) != EOF) {
+        if (c == '\n')
+            lines++;
+    }
+    fclose(file);
+    return lines;
+}
+
+/**
+ * Sprawdza, czy dwa pliki mają taką samą zawartość.
+ * @param[in] a : ścieżka pliku
+ * @param[in] b : ścieżka pliku
+ * @return czy pliki są takie same
+ */
+static bool SameFiles(const char *a, const char *b) {
+    FILE *fa = fopen(a, "r"), *fb = fopen(b, "r");
+    bool same = fa != NULL && fb != NULL;
+    while (same) {
+        int ca = getc(fa), cb = getc(fb);
+        same = ca == cb;
+        if (ca == EOF || cb == EOF)
+            break;
+    }
+    if (fa != NULL)
+        fclose(fa);
+    if (fb != NULL)
+        fclose(fb);
+    return same;
+}
+
+/**
+ * Zapisuje do pliku zawartość innego pliku powtórzoną podaną liczbę razy.
+ * @param[in] source : ścieżka powtarzanego pliku
+ * @param[in] target : ścieżka tworzonego pliku
+ * @param[in] passes : liczba powtórzeń
+ * @return czy się udało
+ */
+static bool RepeatFile(const char *source, const char *target, long passes) {
+    FILE *in = fopen(source, "r"), *out = fopen(target, "w");
+    bool success = in != NULL && out != NULL;
+    char buffer[BUFSIZ];
+    for (long pass = 0; success && pass < passes; pass++) {
+        rewind(in);
+        size_t read;
+        while ((read = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+            success = success && fwrite(buffer, 1, read, out) == read;
+        }
+        success = success && !ferror(in);
+    }
+    if (in != NULL)
+        fclose(in);
+    if (out != NULL && fclose(out) != 0)
+        success = false;
+    return success;
+}
+
+/**
+ * Przekierowuje deskryptor na podany plik.
+ * @param[in] path : ścieżka pliku
+ * @param[in] flags : flagi funkcji open
+ * @param[in] target : przekierowywany deskryptor
+ * @return czy się udało
+ */
+static bool Redirect(const char *path, int flags, int target) {
+    int fd = open(path, flags, 0666);
+    if (fd < 0)
+        return false;
+    bool success = dup2(fd, target) >= 0;
+    close(fd);
+    return success;
+}
+
+/**
+ * Wykonuje skrypt kalkulatorem i mierzy czas i zużycie pamięci.
+ * Przepustowość liczymy względem czasu procesora, bo w przeciwieństwie
+ * do czasu rzeczywistego nie zależy od innych procesów na maszynie.
+ * @param[in] poly : ścieżka kalkulatora
+ * @param[in] input : ścieżka skryptu
+ * @param[in] output : ścieżka pliku na standardowe wyjście
+ * @param[in] error : ścieżka pliku na wyjście błędów
+ * @param[out] seconds : czas procesora
+ * @param[out] wall_seconds : czas rzeczywisty
+ * @param[out] peak_rss_kb : największe zużycie pamięci w KiB
+ * @return czy kalkulator zakończył się poprawnie
+ */
+static bool RunScript(const char *poly, const char *input, const char *output,
+                      const char *error, double *seconds,
+                      double *wall_seconds, long *peak_rss_kb) {
+    int flags = O_WRONLY | O_CREAT | O_TRUNC;
+    double start = Now();
+    pid_t pid = fork();
+    if (pid < 0)
+        return false;
+    if (pid == 0) {
+        if (!Redirect(input, O_RDONLY, STDIN_FILENO) ||
+            !Redirect(output, flags, STDOUT_FILENO) ||
+            !Redirect(error, flags, STDERR_FILENO))
+            _exit(127);
+        execl(poly, poly, (char *) NULL);
+        _exit(127);
+    }
+
+    int status;
+    struct rusage usage;
+    pid_t result;
+    do {
+        result = wait4(pid, &status, 0, &usage);
+    } while (result < 0 && errno == EINTR);
+    *wall_seconds = Now() - start;
+    *seconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 +
+               usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+    *peak_rss_kb = usage.ru_maxrss;
+    return result == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/**
+ * Wczytuje wyniki bazowe z pliku CSV.
+ * @param[in] path : ścieżka pliku
+ * @param[out] baseline : wyniki bazowe
+ * @return liczba wyników (0, jeśli pliku nie ma)
+ */
+static int ReadBaseline(const char *path, ScriptResult baseline[]) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return 0;
+
+    int count = 0;
+    char row[1024];
+    while (count < MAX_SCRIPTS && fgets(row, sizeof(row), file) != NULL) {
+        ScriptResult *r = &baseline[count];
+        if (sscanf(row, "%255[^,],%ld,%lf,%ld", r->name, &r->lines,
+                   &r->lines_per_sec, &r->peak_rss_kb) == 4)
+            count++; // nagłówek nie pasuje do wzorca i jest pomijany
+    }
+    fclose(file);
+    return count;
+}
+
+/**
+ * Zapisuje wyniki jako nowe wyniki bazowe.
+ * @param[in] path : ścieżka pliku
+ * @param[in] results : wyniki
+ * @param[in] count : liczba wyników
+ * @return czy udało się zapisać plik
+ */
+static bool WriteBaseline(const char *path, const ScriptResult results[],
+                          int count) {
+    FILE *file = fopen(path, "w");
+    if (file == NULL)
+        return false;
+    fprintf(file, "script,lines,lines_per_sec,peak_rss_kb\n");
+    for (int i = 0; i < count; i++) {
+        fprintf(file, "%s,%ld,%.0f,%ld\n", results[i].name, results[i].lines,
+                results[i].lines_per_sec, results[i].peak_rss_kb);
+    }
+    return fclose(file) == 0;
+}
+
+/**
+ * Wyszukuje wynik bazowy skryptu.
+ * @param[in] baseline : wyniki bazowe
+ * @param[in] count : liczba wyników bazowych
+ * @param[in] name : nazwa skryptu
+ * @return wynik bazowy lub NULL
+ */
+static const ScriptResult *FindBaseline(const ScriptResult baseline[],
+                                        int count, const char *name) {
+    for (int i = 0; i < count; i++) {
+        if (strcmp(baseline[i].name, name) == 0)
+            return &baseline[i];
+    }
+    return NULL;
+}
+
+/**
+ * Mierzy jeden skrypt korpusu i wypisuje wiersz raportu.
+ * Pierwsze wykonanie skryptu sprawdza jego wynik i wyznacza, ile razy
+ * trzeba go powtórzyć, by przebieg trwał co najmniej
+ * @p options->min_seconds czasu procesora. Skrypty korpusu nie kończą się
+ * błędem, więc żadne polecenie nie sięga pod wielomiany odłożone przez
+ * własny przebieg i każde powtórzenie wykonuje się tak samo jak pierwsze.
+ * @param[in] options : opcje programu
+ * @param[in,out] script : skrypt, uzupełniany o wyniki pomiaru
+ * @param[in] base : wynik bazowy lub NULL
+ * @return czy skrypt przeszedł sprawdzenie
+ */
+static bool MeasureScript(const HarnessOptions *options, ScriptResult *script,
+                          const ScriptResult *base) {
+    char input[PATH_LENGTH], golden_out[PATH_LENGTH], golden_err[PATH_LENGTH];
+    char output[] = "/tmp/poly_throughput_outXXXXXX";
+    char error[] = "/tmp/poly_throughput_errXXXXXX";
+    char repeated[] = "/tmp/poly_throughput_inXXXXXX";
+    snprintf(input, PATH_LENGTH, "%s/%s.in", options->corpus, script->name);
+    snprintf(golden_out, PATH_LENGTH, "%s/%s.out", options->corpus,
+             script->name);
+    snprintf(golden_err, PATH_LENGTH, "%s/%s.err", options->corpus,
+             script->name);
+    int out_fd = mkstemp(output), err_fd = mkstemp(error);
+    int in_fd = mkstemp(repeated);
+    if (out_fd >= 0)
+        close(out_fd);
+    if (err_fd >= 0)
+        close(err_fd);
+    if (in_fd >= 0)
+        close(in_fd);
+
+    const char *status = "OK";
+    double seconds, wall_seconds;
+    long rss;
+    script->lines = CountLines(input);
+    script->passes = 1;
+    if (out_fd < 0 || err_fd < 0 || in_fd < 0 ||
+        !RunScript(options->poly, input, output, error, &seconds,
+                   &wall_seconds, &rss)) {
+        status = "FAILED";
+    } else if (!SameFiles(output, golden_out) ||
+               !SameFiles(error, golden_err)) {
+        status = "WRONG_OUTPUT";
+    }
+
+    // czas pierwszego wykonania zawiera uruchomienie procesu, więc liczbę
+    // powtórzeń poprawiamy, dopóki przebieg jest za krótki
+    for (int round = 0; round < CALIBRATION_ROUNDS &&
+                        strcmp(status, "OK") == 0 &&
+                        seconds < options->min_seconds; round++) {
+        script->passes = (long) (script->passes * options->min_seconds /
+                                 (seconds > 1e-3 ? seconds : 1e-3)) + 1;
+        if (!RepeatFile(input, repeated, script->passes) ||
+            !RunScript(options->poly, repeated, "/dev/null", error, &seconds,
+                       &wall_seconds, &rss))
+            status = "FAILED";
+    }
+    if (strcmp(status, "OK") == 0 && script->passes == 1 &&
+        !RepeatFile(input, repeated, 1))
+        status = "FAILED";
+
+    for (long rep = 0; rep < options->reps && strcmp(status, "OK") == 0;
+         rep++) {
+        if (!RunScript(options->poly, repeated, "/dev/null", error, &seconds,
+                       &wall_seconds, &rss)) {
+            status = "FAILED";
+            break;
+        }
+        if (rep == 0 || seconds < script->seconds)
+            script->seconds = seconds;
+        if (rep == 0 || wall_seconds < script->wall_seconds)
+            script->wall_seconds = wall_seconds;
+        if (rss > script->peak_rss_kb)
+            script->peak_rss_kb = rss;
+    }
+    unlink(output);
+    unlink(error);
+    unlink(repeated);
+
+    script->lines_per_sec = script->seconds > 0 ?
+                            script->lines * script->passes / script->seconds :
+                            0;
+    if (strcmp(status, "OK") == 0 && base != NULL && !options->update) {
+        if (script->lines_per_sec <
+            base->lines_per_sec * (1 - options->tolerance))
+            status = "SLOWER";
+        else if (script->peak_rss_kb >
+                 base->peak_rss_kb * (1 + options->tolerance))
+            status = "MORE_MEMORY";
+    }
+
+    printf("%s,%ld,%ld,%.6f,%.6f,%.0f,%ld,%.0f,%ld,%s\n", script->name,
+           script->lines, script->passes, script->seconds, script->wall_seconds,
+           script->lines_per_sec, script->peak_rss_kb,
+           base != NULL ? base->lines_per_sec : 0,
+           base != NULL ? base->peak_rss_kb : 0, status);
+    return strcmp(status, "OK") == 0;
+}
+
+/**
+ * Wypisuje sposób użycia programu.
+ * @param[in] program : nazwa programu
+ * @return 2 - kod wyjścia programu
+ */
+static int Usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s --poly PATH --corpus DIR [--baseline FILE]\n"
+            "          [--tolerance FRACTION] [--reps N] [--min-seconds S]\n"
+            "          [--update]\n",
+            program);
+    return 2;
+}
+
+/**
+ * Funkcja main testu przepustowości.
+ * Wypisuje raport w formacie CSV na standardowe wyjście.
+ * @param[in] argc : liczba argumentów
+ * @param[in] argv : argumenty
+ * @return 0, jeśli wszystkie skrypty przeszły sprawdzenie, 1 w.p.p.
+ */
+int main(int argc, char *argv[]) {
+    HarnessOptions options = {
+        .poly = NULL, .corpus = NULL, .baseline = NULL,
+        .tolerance = 0.25, .reps = 10, .min_seconds = 0.5,
+        .update = false
+    };
+
+    for (int i = 1; i < argc; i++) {
+        char *end = NULL;
+        if (strcmp(argv[i], "--update") == 0) {
+            options.update = true;
+        } else if (i + 1 == argc) {
+            return Usage(argv[0]);
+        } else if (strcmp(argv[i], "--poly") == 0) {
+            options.poly = argv[++i];
+        } else if (strcmp(argv[i], "--corpus") == 0) {
+            options.corpus = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0) {
+            options.baseline = argv[++i];
+        } else if (strcmp(argv[i], "--tolerance") == 0) {
+            options.tolerance = strtod(argv[++i], &end);
+            if (*end != '\0' || options.tolerance < 0 ||
+                options.tolerance >= 1)
+                return Usage(argv[0]);
+        } else if (strcmp(argv[i], "--reps") == 0) {
+            options.reps = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || options.reps <= 0)
+                return Usage(argv[0]);
+        } else if (strcmp(argv[i], "--min-seconds") == 0) {
+            options.min_seconds = strtod(argv[++i], &end);
+            if (*end != '\0' || options.min_seconds < 0)
+                return Usage(argv[0]);
+        } else {
+            return Usage(argv[0]);
+        }
+    }
+    if (options.poly == NULL || options.corpus == NULL ||
+        (options.update && options.baseline == NULL))
+        return Usage(argv[0]);
+
+    static ScriptResult scripts[MAX_SCRIPTS], baseline[MAX_SCRIPTS];
+    int count = ListScripts(options.corpus, scripts);
+    if (count < 0) {
+        perror(options.corpus);
+        return 1;
+    }
+    int base_count = 0;
+    if (options.baseline != NULL && !options.update)
+        base_count = ReadBaseline(options.baseline, baseline);
+
+    printf("script,lines,passes,cpu_seconds,wall_seconds,lines_per_sec,peak_rss_kb,"
+           "baseline_lines_per_sec,baseline_peak_rss_kb,status\n");
+    int failed = 0;
+    for (int i = 0; i < count; i++) {
+        const ScriptResult *base = FindBaseline(baseline, base_count,
+                                                scripts[i].name);
+        if (!MeasureScript(&options, &scripts[i], base))
+            failed++;
+    }
+
+    if (options.update && failed == 0 &&
+        !WriteBaseline(options.baseline, scripts, count)) {
+        perror(options.baseline);
+        return 1;
+    }
+    if (failed > 0)
+        fprintf(stderr, "%d of %d scripts failed\n", failed, count);
+    return failed > 0 ? 1 : 0;
+}
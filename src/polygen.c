@@ -0,0 +1,406 @@
+/** @file
+  Generator syntetycznych skryptów kalkulatora wielomianów.
+
+  Program wypisuje na standardowe wyjście skrypt w składni kalkulatora.
+  Kształt wielomianów (liczba zmiennych, liczba jednomianów na poziomie,
+  rozkład wykładników, zakres współczynników) oraz częstości poszczególnych
+  poleceń są konfigurowalne, a wynik zależy wyłącznie od ziarna.
+  Generator symuluje stos kalkulatora, więc polecenia są wypisywane tylko
+  wtedy, gdy na stosie jest dość wielomianów, a szacowany rozmiar wyników
+  MUL i COMPOSE jest ograniczony.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+
+/**
+ * Maksymalna liczba zmiennych wielomianu w kalkulatorze nie jest ograniczona,
+ * ale generator ogranicza głębokość zagnieżdżenia.
+ */
+#define MAX_DEPTH 32
+
+/**
+ * To są rodzaje wierszy skryptu.
+ */
+typedef enum LineKind {
+    LINE_POLY, LINE_ZERO, LINE_IS_COEFF, LINE_IS_ZERO, LINE_CLONE, LINE_ADD,
+    LINE_MUL, LINE_NEG, LINE_SUB, LINE_IS_EQ, LINE_DEG, LINE_DEG_BY, LINE_AT,
+    LINE_PRINT, LINE_POP, LINE_COMPOSE, LINE_KINDS
+} LineKind;
+
+/**
+ * Nazwy rodzajów wierszy używane w opcji --mix.
+ */
+static const char *const kind_names[LINE_KINDS] = {
+    "POLY", "ZERO", "IS_COEFF", "IS_ZERO", "CLONE", "ADD", "MUL", "NEG",
+    "SUB", "IS_EQ", "DEG", "DEG_BY", "AT", "PRINT", "POP", "COMPOSE"
+};
+
+/**
+ * Liczba wielomianów, które musi zawierać stos, żeby wykonać polecenie
+ * (dla COMPOSE - bez parametrów).
+ */
+static const size_t kind_needs[LINE_KINDS] = {
+    0, 0, 1, 1, 1, 2, 2, 1, 2, 2, 1, 1, 1, 1, 1, 1
+};
+
+/**
+ * To jest struktura przechowująca opcje generatora.
+ */
+typedef struct GenOptions {
+    unsigned long long seed; ///< ziarno
+    long lines; ///< liczba wierszy skryptu
+    long vars; ///< liczba zmiennych (głębokość zagnieżdżenia)
+    long terms; ///< maksymalna liczba jednomianów na poziomie
+    long max_degree; ///< największy wykładnik
+    bool geometric; ///< czy wykładniki mają rozkład geometryczny
+    long coeff_min; ///< najmniejszy współczynnik
+    long coeff_max; ///< największy współczynnik
+    long max_stack; ///< ile wielomianów może być naraz na stosie
+    double max_size; ///< ograniczenie szacowanej liczby jednomianów wyniku
+    unsigned weights[LINE_KINDS]; ///< częstości rodzajów wierszy
+} GenOptions;
+
+/** Stan generatora liczb pseudolosowych. */
+static unsigned long long rng_state;
+
+/**
+ * Losuje kolejną liczbę (generator splitmix64).
+ * @return liczba pseudolosowa
+ */
+static unsigned long long NextRandom(void) {
+    unsigned long long z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * Losuje liczbę z przedziału [@p min, @p max].
+ * @param[in] min : początek przedziału
+ * @param[in] max : koniec przedziału
+ * @return liczba pseudolosowa
+ */
+static long RandomRange(long min, long max) {
+    unsigned long long width = (unsigned long long) max -
+                               (unsigned long long) min + 1;
+    if (width == 0) // cały zakres typu long
+        return (long) NextRandom();
+    return (long) ((unsigned long long) min + NextRandom() % width);
+}
+
+/**
+ * Losuje wykładnik jednomianu.
+ * @param[in] options : opcje generatora
+ * @return wykładnik
+ */
+static long RandomExp(const GenOptions *options) {
+    if (!options->geometric)
+        return RandomRange(0, options->max_degree);
+
+    long exp = 0;
+    while (exp < options->max_degree && (NextRandom() & 1)) {
+        exp++;
+    }
+    return exp;
+}
+
+/**
+ * Wypisuje losowy wielomian w postaci nawiasowo-plusowej.
+ * @param[in] options : opcje generatora
+ * @param[in] depth : pozostała głębokość zagnieżdżenia
+ * @return liczba jednomianów wypisanego wielomianu
+ */
+static double PrintRandomPoly(const GenOptions *options, long depth) {
+    if (depth == 0) {
+        printf("%ld", RandomRange(options->coeff_min, options->coeff_max));
+        return 1;
+    }
+
+    long terms = RandomRange(1, options->terms);
+    double size = 0;
+    for (long i = 0; i < terms; i++) {
+        printf(i ? "+(" : "(");
+        size += PrintRandomPoly(options, depth - 1);
+        printf(",%ld)", RandomExp(options));
+    }
+    return size;
+}
+
+/**
+ * Ogranicza szacowany rozmiar wielomianu.
+ * @param[in] options : opcje generatora
+ * @param[in] size : szacowany rozmiar
+ * @return rozmiar nie większy niż ograniczenie
+ */
+static double ClampSize(const GenOptions *options, double size) {
+    return size < options->max_size ? size : options->max_size;
+}
+
+/**
+ * Szacuje rozmiar wyniku polecenia COMPOSE: podstawiany wielomian
+ * jest podnoszony do potęgi nie większej niż największy wykładnik.
+ * @param[in] options : opcje generatora
+ * @param[in] sizes : szacowane rozmiary wielomianów na stosie
+ * @param[in] count : liczba wielomianów na stosie
+ * @param[in] k : parametr polecenia
+ * @return szacowany rozmiar wyniku
+ */
+static double ComposeSize(const GenOptions *options, const double sizes[],
+                          size_t count, size_t k) {
+    if (k == 0)
+        return 1;
+    double size = sizes[count - 1];
+    for (size_t i = 0; i < k; i++) {
+        for (long d = 0; d < options->max_degree && size < options->max_size;
+             d++) {
+            size *= sizes[count - 2 - i];
+        }
+    }
+    return ClampSize(options, size);
+}
+
+/**
+ * Losuje rodzaj kolejnego wiersza spośród tych, które można wykonać
+ * przy obecnym stanie stosu.
+ * @param[in] options : opcje generatora
+ * @param[in] sizes : szacowane rozmiary wielomianów na stosie
+ * @param[in] count : liczba wielomianów na stosie
+ * @return rodzaj wiersza lub LINE_KINDS, jeśli żaden nie jest dostępny
+ */
+static LineKind RandomKind(const GenOptions *options, const double sizes[],
+                           size_t count) {
+    unsigned weights[LINE_KINDS];
+    unsigned long total = 0;
+    for (int kind = 0; kind < LINE_KINDS; kind++) {
+        bool allowed = kind_needs[kind] <= count;
+        bool pushes = kind == LINE_POLY || kind == LINE_ZERO ||
+                      kind == LINE_CLONE;
+        if (pushes && count >= (size_t) options->max_stack)
+            allowed = false;
+        if (kind == LINE_MUL && allowed &&
+            sizes[count - 1] * sizes[count - 2] >= options->max_size)
+            allowed = false;
+        weights[kind] = allowed ? options->weights[kind] : 0;
+        total += weights[kind];
+    }
+    if (total == 0)
+        return LINE_KINDS;
+
+    unsigned long pick = NextRandom() % total;
+    int kind = 0;
+    while (pick >= weights[kind]) {
+        pick -= weights[kind];
+        kind++;
+    }
+    return (LineKind) kind;
+}
+
+/**
+ * Wypisuje skrypt.
+ * @param[in] options : opcje generatora
+ */
+static void Generate(const GenOptions *options) {
+    double *sizes = malloc((size_t) options->max_stack * sizeof(double));
+    if (sizes == NULL)
+        exit(1);
+    size_t count = 0;
+
+    for (long line = 0; line < options->lines; line++) {
+        LineKind kind = RandomKind(options, sizes, count);
+        if (kind == LINE_KINDS) {
+            // nic nie da się wykonać, opróżniamy stos
+            kind = count > 0 ? LINE_POP : LINE_ZERO;
+        }
+
+        if (kind == LINE_POLY) {
+            sizes[count++] = PrintRandomPoly(options, options->vars);
+            printf("\n");
+            continue;
+        }
+        printf("%s", kind_names[kind]);
+        switch (kind) {
+            case LINE_ZERO:
+                sizes[count++] = 1;
+                break;
+            case LINE_CLONE:
+                sizes[count] = sizes[count - 1];
+                count++;
+                break;
+            case LINE_ADD:
+            case LINE_SUB:
+                sizes[count - 2] = ClampSize(options,
+                                             sizes[count - 1] + sizes[count - 2]);
+                count--;
+                break;
+            case LINE_MUL:
+                sizes[count - 2] = ClampSize(options,
+                                             sizes[count - 1] * sizes[count - 2]);
+                count--;
+                break;
+            case LINE_POP:
+                count--;
+                break;
+            case LINE_DEG_BY:
+                printf(" %ld", RandomRange(0, options->vars));
+                break;
+            case LINE_AT:
+                printf(" %ld", RandomRange(options->coeff_min,
+                                           options->coeff_max));
+                break;
+            case LINE_COMPOSE: {
+                size_t k = (size_t) RandomRange(0, options->vars);
+                if (k > count - 1)
+                    k = count - 1;
+                double size = ComposeSize(options, sizes, count, k);
+                // zmniejszamy k, aż szacowany rozmiar wyniku będzie rozsądny;
+                // przy k = 0 wynik ma rozmiar 1, nawet gdy --max-size to 1
+                while (k > 0 && size >= options->max_size) {
+                    k--;
+                    size = ComposeSize(options, sizes, count, k);
+                }
+                printf(" %zu", k);
+                count -= k;
+                sizes[count - 1] = size;
+                break;
+            }
+            default:
+                break;
+        }
+        printf("\n");
+    }
+    free(sizes);
+}
+
+/**
+ * Parsuje liczbę całkowitą z zadanego przedziału.
+ * @param[in] s : napis
+ * @param[in] min : najmniejsza dopuszczalna wartość
+ * @param[in] max : największa dopuszczalna wartość
+ * @param[out] value : wartość
+ * @return czy napis jest poprawny
+ */
+static bool ParseLong(const char *s, long min, long max, long *value) {
+    char *end;
+    *value = strtol(s, &end, 10);
+    return end != s && *end == '\0' && *value >= min && *value <= max;
+}
+
+/**
+ * Parsuje częstości rodzajów wierszy w postaci NAZWA=WAGA,NAZWA=WAGA...
+ * Rodzaje niewymienione zachowują dotychczasową częstość.
+ * @param[in] s : napis
+ * @param[in,out] weights : częstości
+ * @return czy napis jest poprawny
+ */
+static bool ParseMix(const char *s, unsigned weights[]) {
+    while (*s != '\0') {
+        const char *equals = strchr(s, '=');
+        if (equals == NULL)
+            return false;
+        int kind = 0;
+        while (kind < LINE_KINDS &&
+               (strlen(kind_names[kind]) != (size_t) (equals - s) ||
+                strncmp(kind_names[kind], s, (size_t) (equals - s)) != 0)) {
+            kind++;
+        }
+        if (kind == LINE_KINDS)
+            return false;
+
+        char *end;
+        unsigned long weight = strtoul(equals + 1, &end, 10);
+        if (end == equals + 1 || weight > 1000000 ||
+            (*end != ',' && *end != '\0'))
+            return false;
+        weights[kind] = (unsigned) weight;
+        s = *end == ',' ? end + 1 : end;
+    }
+    return true;
+}
+
+/**
+ * Wypisuje sposób użycia programu.
+ * @param[in] program : nazwa programu
+ * @return 1 - kod wyjścia programu
+ */
+static int Usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [--seed N] [--lines N] [--vars N] [--terms N]\n"
+            "          [--max-degree N] [--degrees uniform|geometric]\n"
+            "          [--coeff-min N] [--coeff-max N] [--max-stack N]\n"
+            "          [--max-size N] [--mix NAME=WEIGHT,...]\n",
+            program);
+    return 1;
+}
+
+/**
+ * Funkcja main generatora.
+ * @param[in] argc : liczba argumentów
+ * @param[in] argv : argumenty
+ * @return 0, jeśli program zakończył się poprawnie, 1 w.p.p.
+ */
+int main(int argc, char *argv[]) {
+    GenOptions options = {
+        .seed = 1, .lines = 1000, .vars = 2, .terms = 4, .max_degree = 8,
+        .geometric = false, .coeff_min = -100, .coeff_max = 100,
+        .max_stack = 32, .max_size = 10000,
+        .weights = {
+            [LINE_POLY] = 30, [LINE_ZERO] = 1, [LINE_IS_COEFF] = 2,
+            [LINE_IS_ZERO] = 2, [LINE_CLONE] = 5, [LINE_ADD] = 10,
+            [LINE_MUL] = 8, [LINE_NEG] = 3, [LINE_SUB] = 5, [LINE_IS_EQ] = 3,
+            [LINE_DEG] = 2, [LINE_DEG_BY] = 2, [LINE_AT] = 4,
+            [LINE_PRINT] = 10, [LINE_POP] = 10, [LINE_COMPOSE] = 3
+        }
+    };
+
+    for (int i = 1; i < argc; i++) {
+        const char *option = argv[i];
+        if (i + 1 == argc)
+            return Usage(argv[0]);
+        const char *value = argv[++i];
+        long number;
+        bool ok = true;
+        if (strcmp(option, "--seed") == 0) {
+            ok = ParseLong(value, 0, LONG_MAX, &number);
+            options.seed = (unsigned long long) number;
+        } else if (strcmp(option, "--lines") == 0) {
+            ok = ParseLong(value, 0, LONG_MAX, &options.lines);
+        } else if (strcmp(option, "--vars") == 0) {
+            ok = ParseLong(value, 0, MAX_DEPTH, &options.vars);
+        } else if (strcmp(option, "--terms") == 0) {
+            ok = ParseLong(value, 1, 1000000, &options.terms);
+        } else if (strcmp(option, "--max-degree") == 0) {
+            ok = ParseLong(value, 0, INT_MAX, &options.max_degree);
+        } else if (strcmp(option, "--degrees") == 0) {
+            options.geometric = strcmp(value, "geometric") == 0;
+            ok = options.geometric || strcmp(value, "uniform") == 0;
+        } else if (strcmp(option, "--coeff-min") == 0) {
+            ok = ParseLong(value, LONG_MIN, LONG_MAX, &options.coeff_min);
+        } else if (strcmp(option, "--coeff-max") == 0) {
+            ok = ParseLong(value, LONG_MIN, LONG_MAX, &options.coeff_max);
+        } else if (strcmp(option, "--max-stack") == 0) {
+            ok = ParseLong(value, 2, 1000000, &options.max_stack);
+        } else if (strcmp(option, "--max-size") == 0) {
+            ok = ParseLong(value, 1, LONG_MAX, &number);
+            options.max_size = (double) number;
+        } else if (strcmp(option, "--mix") == 0) {
+            ok = ParseMix(value, options.weights);
+        } else {
+            ok = false;
+        }
+        if (!ok)
+            return Usage(argv[0]);
+    }
+    if (options.coeff_min > options.coeff_max)
+        return Usage(argv[0]);
+
+    rng_state = options.seed;
+    Generate(&options);
+    return fflush(stdout) == 0 ? 0 : 1;
+}
@@ -0,0 +1,379 @@
+/** @file
+  Implementacja trybu serwera kalkulatora.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include "server.h"
+#include "input_output.h"
+#include "parsing.h"
+#include "commands.h"
+#include "mallocs.h"
+#include "stack.h"
+
+/**
+ * To jest struktura przechowująca stan serwera wspólny dla wątków puli.
+ */
+typedef struct Server {
+    int queue[SERVER_QUEUE_SIZE]; ///< cykliczna kolejka przyjętych połączeń
+    size_t head; ///< indeks najstarszego połączenia w kolejce
+    size_t count; ///< liczba połączeń w kolejce
+    bool stopping; ///< czy serwer kończy działanie
+    int *active; ///< połączenie obsługiwane przez każdy wątek lub -1
+    long workers; ///< liczba wątków puli
+    long long session_memory; ///< limit pamięci sesji
+    pthread_mutex_t mutex; ///< chroni kolejkę, pola stopping i active
+    pthread_cond_t not_empty; ///< sygnalizuje pojawienie się połączenia
+    pthread_cond_t not_full; ///< sygnalizuje zwolnienie miejsca w kolejce
+} Server;
+
+/**
+ * To jest struktura przechowująca argument wątku puli.
+ */
+typedef struct ServerWorker {
+    Server *server; ///< serwer
+    long index; ///< nr wątku
+} ServerWorker;
+
+/**
+ * To jest struktura przechowująca stan jednej sesji.
+ */
+typedef struct Session {
+    InputReader reader; ///< bufor wejścia połączenia
+    PolyStack stack; ///< stos sesji
+    MemoryBudget budget; ///< budżet pamięci sesji
+    int line; ///< nr bieżącego wiersza
+} Session;
+
+/** Łącze, którym procedura obsługi sygnału budzi pętlę przyjmującą. */
+static int stop_pipe[2] = {-1, -1};
+
+/**
+ * Procedura obsługi sygnałów kończących serwer.
+ * @param[in] signal_number : nr sygnału
+ */
+static void StopServer(int signal_number) {
+    (void) signal_number;
+    int saved_errno = errno;
+    ssize_t ignored = write(stop_pipe[1], "", 1);
+    (void) ignored;
+    errno = saved_errno;
+}
+
+/**
+ * Wykonuje wiersze sesji aż do końca wejścia klienta albo jego rozłączenia
+ * lub wyczerpania budżetu pamięci. Każdy wiersz jest osobnym obszarem
+ * alokacji, więc nieudana alokacja zwalnia tylko pamięć przerwanego
+ * polecenia, a polecenia zmieniają stos dopiero po wyliczeniu wyniku.
+ * @param[in,out] session : sesja
+ */
+static void RunSession(Session *session) {
+    while (!OutputFailed()) {
+        AllocationGuard guard;
+        BeginAllocationGuard(&guard);
+        if (setjmp(guard.handler) != 0) {
+            PrintError(session->line, "OUT OF MEMORY");
+            return;
+        }
+        StringWithSize str;
+        bool has_line = ReadLine(&session->reader, &str);
+        if (has_line)
+            AnalyzeLine(str, session->line, &session->stack);
+        EndAllocationGuard(&guard);
+        if (!has_line)
+            return;
+        session->line++;
+    }
+}
+
+/**
+ * Obsługuje sesję na połączeniu @p fd w bieżącym wątku. Wyniki i błędy
+ * sesji trafiają do połączenia, a jej alokacje są ograniczone budżetem.
+ * @param[in] fd : połączenie
+ * @param[in] session_memory : limit pamięci sesji
+ */
+static void ServeSession(int fd, long long session_memory) {
+    Session *session = malloc(sizeof(Session));
+    if (session == NULL)
+        return;
+
+    session->budget = (MemoryBudget) {.live_bytes = 0,
+                                      .limit = session_memory};
+    session->line = 1;
+    RedirectOutput(fd);
+    MemoryBudget *previous_budget = SetMemoryBudget(&session->budget);
+    AllocationGuard guard;
+    BeginAllocationGuard(&guard);
+    if (setjmp(guard.handler) == 0) {
+        session->reader = ReaderInitDescriptor(fd);
+        session->reader.binary = binary_input;
+        session->stack = StackInit(INITIAL_STACK_SIZE);
+        EndAllocationGuard(&guard);
+
+        RunSession(session);
+        StackClear(&session->stack);
+        ReaderClear(&session->reader);
+    } else {
+        PrintError(session->line, "OUT OF MEMORY");
+    }
+    SetMemoryBudget(previous_budget);
+    RedirectOutput(-1);
+    free(session);
+}
+
+/**
+ * Czeka na połączenie w kolejce i przydziela je wątkowi.
+ * @param[in,out] server : serwer
+ * @param[in] index : nr wątku
+ * @return połączenie lub -1, jeśli serwer kończy działanie
+ */
+static int TakeSession(Server *server, long index) {
+    pthread_mutex_lock(&server->mutex);
+    while (server->count == 0 && !server->stopping) {
+        pthread_cond_wait(&server->not_empty, &server->mutex);
+    }
+    int fd = -1;
+    if (server->count > 0) {
+        fd = server->queue[server->head];
+        server->head = (server->head + 1) % SERVER_QUEUE_SIZE;
+        server->count--;
+        server->active[index] = fd;
+        pthread_cond_signal(&server->not_full);
+    }
+    pthread_mutex_unlock(&server->mutex);
+    return fd;
+}
+
+/**
+ * Zamyka obsłużone połączenie. Zamknięcie następuje pod blokadą, żeby
+ * kończący się serwer nie przerwał połączenia o tym samym numerze
+ * przyjętego w międzyczasie.
+ * @param[in,out] server : serwer
+ * @param[in] index : nr wątku
+ */
+static void FinishSession(Server *server, long index) {
+    pthread_mutex_lock(&server->mutex);
+    close(server->active[index]);
+    server->active[index] = -1;
+    pthread_mutex_unlock(&server->mutex);
+}
+
+/**
+ * Funkcja wątku puli. Obsługuje kolejne połączenia z kolejki.
+ * @param[in] arg : argument wątku
+ * @return NULL
+ */
+static void *WorkerThread(void *arg) {
+    ServerWorker *worker = arg;
+    Server *server = worker->server;
+    int fd;
+    while ((fd = TakeSession(server, worker->index)) >= 0) {
+        ServeSession(fd, server->session_memory);
+        FinishSession(server, worker->index);
+    }
+    return NULL;
+}
+
+/**
+ * Wstawia przyjęte połączenie do kolejki, czekając na wolne miejsce.
+ * @param[in,out] server : serwer
+ * @param[in] fd : połączenie
+ */
+static void QueueSession(Server *server, int fd) {
+    pthread_mutex_lock(&server->mutex);
+    while (server->count == SERVER_QUEUE_SIZE) {
+        pthread_cond_wait(&server->not_full, &server->mutex);
+    }
+    size_t tail = (server->head + server->count) % SERVER_QUEUE_SIZE;
+    server->queue[tail] = fd;
+    server->count++;
+    pthread_cond_signal(&server->not_empty);
+    pthread_mutex_unlock(&server->mutex);
+}
+
+/**
+ * Kończy pracę puli: zamyka połączenia czekające w kolejce, przerywa
+ * trwające sesje i budzi wszystkie wątki.
+ * @param[in,out] server : serwer
+ */
+static void StopWorkers(Server *server) {
+    pthread_mutex_lock(&server->mutex);
+    server->stopping = true;
+    for (; server->count > 0; server->count--) {
+        close(server->queue[server->head]);
+        server->head = (server->head + 1) % SERVER_QUEUE_SIZE;
+    }
+    for (long i = 0; i < server->workers; i++) {
+        if (server->active[i] >= 0)
+            shutdown(server->active[i], SHUT_RDWR);
+    }
+    pthread_cond_broadcast(&server->not_empty);
+    pthread_mutex_unlock(&server->mutex);
+}
+
+/**
+ * Tworzy gniazdo nasłuchujące pod podaną ścieżką. Pozostałe po poprzednim
+ * serwerze gniazdo jest usuwane, ale inny plik nie jest nadpisywany.
+ * @param[in] path : ścieżka gniazda
+ * @return gniazdo lub -1 w przypadku błędu (wypisanego na stderr)
+ */
+static int OpenListener(const char *path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "%s: socket path too long\n", path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    struct stat info;
+    if (lstat(path, &info) == 0 && S_ISSOCK(info.st_mode))
+        unlink(path);
+
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("socket");
+        return -1;
+    }
+    if (bind(listener, (struct sockaddr *) &address, sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0) {
+        perror(path);
+        close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+/**
+ * Przyjmuje połączenia i przekazuje je do kolejki, dopóki nie nadejdzie
+ * sygnał kończący serwer.
+ * @param[in,out] server : serwer
+ * @param[in] listener : gniazdo nasłuchujące
+ */
+static void AcceptSessions(Server *server, int listener) {
+    struct pollfd fds[2] = {{.fd = listener, .events = POLLIN},
+                            {.fd = stop_pipe[0], .events = POLLIN}};
+    while (true) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("poll");
+            return;
+        }
+        if (fds[1].revents != 0)
+            return;
+        if (fds[0].revents == 0)
+            continue;
+
+        int fd = accept(listener, NULL, NULL);
+        if (fd >= 0) {
+            QueueSession(server, fd);
+        } else if (errno != EINTR && errno != ECONNABORTED) {
+            perror("accept");
+        }
+    }
+}
+
+/**
+ * Ustawia procedury obsługi sygnałów serwera. Zapis do rozłączonego
+ * klienta ma zwracać błąd zamiast kończyć proces sygnałem SIGPIPE.
+ */
+static void SetSignalHandlers(void) {
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    sigemptyset(&action.sa_mask);
+    action.sa_handler = StopServer;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+    action.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &action, NULL);
+}
+
+int RunServer(const char *path, long workers, long long session_memory,
+              const CalcOptions *options) {
+    // równoległość zapewniają sesje; pomocnicze wątki parsujące
+    // alokowałyby poza budżetem sesji
+    SetParseThreads(1);
+    SetPrintThreads(1);
+    binary_input = options->binary_input;
+    binary_output = options->binary_output;
+
+    if (pipe(stop_pipe) != 0) {
+        perror("pipe");
+        return 1;
+    }
+    int listener = OpenListener(path);
+    if (listener < 0)
+        return 1;
+    SetSignalHandlers();
+
+    Server *server = malloc(sizeof(Server));
+    ServerWorker *args = malloc((size_t) workers * sizeof(ServerWorker));
+    pthread_t *threads = malloc((size_t) workers * sizeof(pthread_t));
+    if (server == NULL || args == NULL || threads == NULL)
+        exit(1);
+    server->head = 0;
+    server->count = 0;
+    server->stopping = false;
+    server->workers = workers;
+    server->session_memory = session_memory;
+    server->active = malloc((size_t) workers * sizeof(int));
+    if (server->active == NULL)
+        exit(1);
+    pthread_mutex_init(&server->mutex, NULL);
+    pthread_cond_init(&server->not_empty, NULL);
+    pthread_cond_init(&server->not_full, NULL);
+
+    for (long i = 0; i < workers; i++) {
+        server->active[i] = -1;
+    }
+    long started = 0;
+    for (; started < workers; started++) {
+        args[started] = (ServerWorker) {.server = server, .index = started};
+        if (pthread_create(&threads[started], NULL, WorkerThread,
+                           &args[started]) != 0)
+            break;
+    }
+    int result = 0;
+    if (started == 0) {
+        perror("pthread_create");
+        result = 1;
+    } else {
+        AcceptSessions(server, listener);
+    }
+
+    close(listener);
+    unlink(path);
+    StopWorkers(server);
+    for (long i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&server->not_full);
+    pthread_cond_destroy(&server->not_empty);
+    pthread_mutex_destroy(&server->mutex);
+    free(server->active);
+    free(server);
+    free(args);
+    free(threads);
+    close(stop_pipe[0]);
+    close(stop_pipe[1]);
+    return result;
+}
@@ -0,0 +1,53 @@
+/** @file
+  Tryb serwera kalkulatora: sesje przez gniazdo domeny uniksowej,
+  obsługiwane przez pulę wątków.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "calc.h"
+
+/**
+ * Ile przyjętych połączeń może czekać na wolny wątek puli.
+ */
+#define SERVER_QUEUE_SIZE 64
+
+/**
+ * Domyślny limit pamięci jednej sesji w bajtach.
+ */
+#define SERVER_SESSION_MEMORY (256LL << 20)
+
+/**
+ * Najmniejszy dopuszczalny limit pamięci sesji w bajtach (bufor wejścia
+ * i stos sesji muszą się w nim zmieścić).
+ */
+#define SERVER_MIN_SESSION_MEMORY (1LL << 20)
+
+/**
+ * Nasłuchuje na gnieździe domeny uniksowej pod ścieżką @p path i obsługuje
+ * połączenia jako niezależne sesje kalkulatora: każda ma własny stos
+ * i numerację wierszy, przyjmuje wiersze w zwykłym języku poleceń,
+ * a wyniki i błędy (w kolejności wykonania) odsyła tym samym połączeniem.
+ * Sesja kończy się z końcem wejścia klienta.
+ * Sesje obsługuje @p workers wątków, każdy po jednej sesji naraz; kolejne
+ * połączenia czekają w kolejce. Polecenie, które przekroczyłoby limit
+ * pamięci sesji, kończy sesję błędem OUT OF MEMORY; pamięć zaalokowana
+ * przez przerwane polecenie jest zwalniana, a stos pozostaje taki jak przed
+ * nim i jest zwalniany wraz z sesją. Polecenie MEMSTATS wypisuje w sesji
+ * zużycie pamięci tej sesji i jej limit.
+ * Serwer kończy działanie po sygnale SIGINT lub SIGTERM, przerywając
+ * trwające sesje, i usuwa gniazdo.
+ * @param[in] path : ścieżka gniazda
+ * @param[in] workers : liczba wątków obsługujących sesje
+ * @param[in] session_memory : limit pamięci sesji w bajtach
+ * @param[in] options : opcje wykonywania (uwzględniany jest format binarny)
+ * @return 0, jeśli serwer zakończył się poprawnie, 1 w.p.p.
+ */
+int RunServer(const char *path, long workers, long long session_memory,
+              const CalcOptions *options);
+
+#endif //SERVER_H
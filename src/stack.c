@@ -13,7 +13,7 @@
 PolyStack StackInit(size_t capacity) {
     PolyStack stack;
     stack.capacity = capacity;
-    stack.top = -1;
+    stack.size = 0;
     SafeStackMalloc(&stack);
     return stack;
 }
@@ -23,32 +23,32 @@ void StackResize(PolyStack *stack) {
 }
 
 void StackClear(PolyStack *stack) {
-    for (int i = 0; i <= stack->top; i++) {
+    for (size_t i = 0; i < stack->size; i++) {
         Poly p = stack->polys[i];
         PolyDestroy(&p);
     }
-    free(stack->polys);
+    StackArrayFree(stack);
 }
 
 bool StackIsFull(PolyStack *stack) {
-    return stack->top == (int)(stack->capacity - 1);
+    return stack->size == stack->capacity;
 }
 
 bool StackIsEmpty(PolyStack *stack) {
-    return stack->top == -1;
+    return stack->size == 0;
 }
 
 void StackPush(PolyStack *stack, Poly p) {
     if (StackIsFull(stack)) {
         StackResize(stack);
     }
-    (stack->top)++;
-    stack->polys[stack->top] = p;
+    stack->polys[stack->size] = p;
+    (stack->size)++;
 }
 
 void StackPop(PolyStack *stack) {
     if (!StackIsEmpty(stack)) {
-        (stack->top)--;
+        (stack->size)--;
     }
 }
 
@@ -58,7 +58,7 @@ Poly StackTop(PolyStack *stack, bool *empty) {
         return PolyZero();
     }
     *empty = false;
-    return stack->polys[stack->top];
+    return stack->polys[stack->size - 1];
 }
 
 
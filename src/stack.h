@@ -20,14 +20,13 @@
  * To jest struktura przechowująca stos wielomianów.
  */
 typedef struct PolyStack {
-    int top; ///< indeks szczytowego elementu
+    size_t size; ///< liczba wielomianów na stosie
     size_t capacity; ///< pojemność stosu
     Poly *polys; ///< tablica wielomianów
 } PolyStack;
 
 /**
  * Tworzy pusty stos o zadanej pojemności.
- * Ustawia top na -1.
  * @param[in] capacity : pojemność stosu
  * @return stos
  */
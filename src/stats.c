@@ -0,0 +1,165 @@
+/** @file
+  Implementacja statystyk wykonywania poleceń kalkulatora.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#include <stdlib.h>
+#include "stats.h"
+#include "measure.h"
+
+/**
+ * To jest struktura przechowująca statystyki jednego rodzaju wierszy
+ * albo jednego wiersza.
+ */
+typedef struct StatsEntry {
+    const char *name; ///< nazwa polecenia
+    int line; ///< nr wiersza (tylko w statystykach wierszy)
+    unsigned long long count; ///< liczba wykonań
+    unsigned long long time_ns; ///< łączny czas w nanosekundach
+    unsigned long long allocs; ///< łączna liczba alokacji jednomianów
+    unsigned long long bytes; ///< łączna liczba zaalokowanych bajtów
+    unsigned long long terms; ///< łączny rozmiar wyników
+    unsigned long long max_terms; ///< największy rozmiar wyniku
+} StatsEntry;
+
+bool stats_enabled = false;
+
+/** Statystyki rodzajów wierszy (polecenia i wielomiany). */
+static StatsEntry kinds[MEASURE_MAX_KINDS];
+/** Tabela statystyk rodzajów wierszy. */
+static KindTable kind_table = {.entries = kinds,
+                               .entry_size = sizeof(StatsEntry)};
+
+/** Czy zapamiętujemy statystyki każdego wiersza? */
+static bool stats_per_line = false;
+/** Statystyki kolejnych wierszy. */
+static StatsEntry *lines = NULL;
+/** Liczba zapamiętanych wierszy. */
+static size_t line_count = 0;
+/** Na ile wierszy została zaalokowana pamięć. */
+static size_t line_capacity = 0;
+
+/**
+ * Liczy jednomiany wielomianu na wszystkich poziomach.
+ * @param[in] p : wielomian
+ * @return liczba jednomianów
+ */
+static unsigned long long CountTerms(const Poly *p) {
+    if (PolyIsCoeff(p))
+        return 0;
+    unsigned long long terms = p->size;
+    for (size_t i = 0; i < p->size; i++) {
+        terms += CountTerms(&p->arr[i].p);
+    }
+    return terms;
+}
+
+/**
+ * Dolicza pomiar do statystyk.
+ * @param[in,out] entry : statystyki
+ * @param[in] sample : pomiar jednego wiersza
+ */
+static void AddSample(StatsEntry *entry, const StatsEntry *sample) {
+    entry->count++;
+    entry->time_ns += sample->time_ns;
+    entry->allocs += sample->allocs;
+    entry->bytes += sample->bytes;
+    entry->terms += sample->terms;
+    if (sample->terms > entry->max_terms)
+        entry->max_terms = sample->terms;
+}
+
+void StatsEnable(bool per_line) {
+    stats_enabled = true;
+    stats_per_line = per_line;
+}
+
+StatsSample StatsBegin(void) {
+    StatsSample sample;
+    sample.counters = GetMonoAllocCounters();
+    sample.start_ns = NowNs();
+    return sample;
+}
+
+void StatsEnd(const StatsSample *sample, const char *name, int line,
+              PolyStack *stack) {
+    long long end_ns = NowNs();
+    MonoAllocCounters counters = GetMonoAllocCounters();
+    bool empty;
+    Poly top = StackTop(stack, &empty);
+
+    StatsEntry measured = {
+        .name = name,
+        .line = line,
+        .time_ns = (unsigned long long) (end_ns - sample->start_ns),
+        .allocs = counters.allocs - sample->counters.allocs,
+        .bytes = counters.bytes - sample->counters.bytes,
+        .terms = empty ? 0 : CountTerms(&top)
+    };
+
+    StatsEntry *kind = FindKind(&kind_table, name);
+    if (kind != NULL)
+        AddSample(kind, &measured);
+
+    if (stats_per_line) {
+        if (line_count == line_capacity) {
+            line_capacity = 1 + 2 * line_capacity;
+            lines = realloc(lines, line_capacity * sizeof(StatsEntry));
+            if (lines == NULL)
+                AllocationFailed();
+        }
+        measured.count = 1;
+        measured.max_terms = measured.terms;
+        lines[line_count++] = measured;
+    }
+}
+
+/**
+ * Wypisuje wiersz tabeli statystyk.
+ * @param[in] out : plik
+ * @param[in] label : etykieta wiersza tabeli
+ * @param[in] entry : statystyki
+ */
+static void PrintEntry(FILE *out, const char *label, const StatsEntry *entry) {
+    unsigned long long count = entry->count ? entry->count : 1;
+    PrintKindLabel(out, label, entry->count);
+    fprintf(out, " %12.3f %10.3f %12llu %14llu %12llu %12llu\n",
+            entry->time_ns / 1e6,
+            entry->time_ns / 1e3 / count, entry->allocs, entry->bytes,
+            entry->terms / count, entry->max_terms);
+}
+
+void StatsReport(FILE *out) {
+    StatsEntry total = {.name = "TOTAL"};
+    PrintKindHeader(out);
+    fprintf(out, " %12s %10s %12s %14s %12s %12s\n", "total_ms", "avg_us",
+            "mono_allocs", "mono_bytes", "avg_terms", "max_terms");
+    for (size_t i = 0; i < kind_table.count; i++) {
+        PrintEntry(out, kinds[i].name, &kinds[i]);
+        total.count += kinds[i].count;
+        total.time_ns += kinds[i].time_ns;
+        total.allocs += kinds[i].allocs;
+        total.bytes += kinds[i].bytes;
+        total.terms += kinds[i].terms;
+        if (kinds[i].max_terms > total.max_terms)
+            total.max_terms = kinds[i].max_terms;
+    }
+    PrintEntry(out, total.name, &total);
+
+    if (stats_per_line && line_count > 0) {
+        fprintf(out, "\n%-10s %-12s %12s %12s %14s %12s\n", "line",
+                "command", "time_us", "mono_allocs", "mono_bytes", "terms");
+        for (size_t i = 0; i < line_count; i++) {
+            fprintf(out, "%-10d %-12s %12.3f %12llu %14llu %12llu\n",
+                    lines[i].line, lines[i].name, lines[i].time_ns / 1e3,
+                    lines[i].allocs, lines[i].bytes, lines[i].terms);
+        }
+    }
+
+    free(lines);
+    lines = NULL;
+    line_count = line_capacity = 0;
+    kind_table.count = 0;
+}
@@ -0,0 +1,64 @@
+/** @file
+  Statystyki wykonywania poleceń kalkulatora (tryb --stats).
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stdio.h>
+#include "mallocs.h"
+#include "stack.h"
+
+/**
+ * Nazwa, pod którą zliczane są wiersze z wielomianami.
+ */
+#define STATS_POLY_NAME "POLY"
+
+/**
+ * To jest struktura przechowująca stan liczników na początku
+ * mierzonego wiersza.
+ */
+typedef struct StatsSample {
+    long long start_ns; ///< czas rozpoczęcia w nanosekundach
+    MonoAllocCounters counters; ///< liczniki alokacji jednomianów
+} StatsSample;
+
+/**
+ * Czy statystyki są zbierane?
+ */
+extern bool stats_enabled;
+
+/**
+ * Włącza zbieranie statystyk.
+ * @param[in] per_line : czy zapamiętywać też statystyki każdego wiersza
+ */
+void StatsEnable(bool per_line);
+
+/**
+ * Zapamiętuje stan liczników przed wykonaniem wiersza.
+ * @return stan liczników
+ */
+StatsSample StatsBegin(void);
+
+/**
+ * Dolicza wykonany wiersz do statystyk. Rozmiarem wyniku jest liczba
+ * jednomianów (na wszystkich poziomach) wielomianu ze szczytu stosu.
+ * @param[in] sample : stan liczników przed wykonaniem wiersza
+ * @param[in] name : nazwa polecenia lub STATS_POLY_NAME
+ * @param[in] line : nr wiersza
+ * @param[in] stack : stos po wykonaniu wiersza
+ */
+void StatsEnd(const StatsSample *sample, const char *name, int line,
+              PolyStack *stack);
+
+/**
+ * Wypisuje tabelę statystyk i zwalnia zebrane dane.
+ * @param[in] out : plik, do którego trafia tabela
+ */
+void StatsReport(FILE *out);
+
+#endif //STATS_H
@@ -0,0 +1,94 @@
+/** @file
+  Implementacja zapisu przebiegu wykonywania kalkulatora.
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "trace.h"
+#include "measure.h"
+
+bool trace_enabled = false;
+
+/** Plik, do którego zapisywane są zdarzenia. */
+static FILE *trace_file = NULL;
+/** Chroni plik i pole first_event. */
+static pthread_mutex_t trace_mutex = PTHREAD_MUTEX_INITIALIZER;
+/** Czy nie zapisano jeszcze żadnego zdarzenia. */
+static bool first_event = true;
+/** Maksymalna głębokość zagnieżdżenia zapisywanych przedziałów. */
+static int trace_max_depth = TRACE_DEFAULT_DEPTH;
+/** Czas rozpoczęcia zapisu w nanosekundach. */
+static long long trace_start_ns;
+/** Identyfikator procesu. */
+static long trace_pid;
+
+/** Numer, który otrzyma kolejny zapisujący wątek. */
+static atomic_int next_thread_id = 1;
+/** Numer bieżącego wątku w zapisie (0 - jeszcze nie nadany). */
+static _Thread_local int thread_id = 0;
+/** Głębokość zagnieżdżenia otwartych przedziałów bieżącego wątku. */
+static _Thread_local int depth = 0;
+
+bool TraceOpen(const char *path, int max_depth) {
+    trace_file = fopen(path, "w");
+    if (trace_file == NULL)
+        return false;
+
+    fputs("{\"traceEvents\":[", trace_file);
+    first_event = true;
+    trace_max_depth = max_depth;
+    trace_start_ns = NowNs();
+    trace_pid = (long) getpid();
+    trace_enabled = true;
+    return true;
+}
+
+void TraceClose(void) {
+    if (!trace_enabled)
+        return;
+    trace_enabled = false;
+    fputs("\n],\"displayTimeUnit\":\"ns\"}\n", trace_file);
+    fclose(trace_file);
+    trace_file = NULL;
+}
+
+TraceSpan TraceBeginEnabled(void) {
+    depth++;
+    TraceSpan span = {0, depth <= trace_max_depth};
+    if (span.recorded)
+        span.start_ns = NowNs();
+    return span;
+}
+
+void TraceEndEnabled(const TraceSpan *span, const char *name,
+                     const char *category, int line) {
+    depth--;
+    if (!span->recorded)
+        return;
+
+    long long end_ns = NowNs();
+    if (thread_id == 0)
+        thread_id = atomic_fetch_add(&next_thread_id, 1);
+
+    pthread_mutex_lock(&trace_mutex);
+    fprintf(trace_file,
+            "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+            "\"ts\":%.3f,\"dur\":%.3f,\"pid\":%ld,\"tid\":%d",
+            first_event ? "" : ",", name, category,
+            (span->start_ns - trace_start_ns) / 1e3,
+            (end_ns - span->start_ns) / 1e3, trace_pid, thread_id);
+    if (line > 0)
+        fprintf(trace_file, ",\"args\":{\"line\":%d}", line);
+    fputc('}', trace_file);
+    first_event = false;
+    pthread_mutex_unlock(&trace_mutex);
+}
@@ -0,0 +1,102 @@
+/** @file
+  Zapis przebiegu wykonywania kalkulatora w formacie Chrome Trace Event
+  (do obejrzenia w chrome://tracing lub Perfetto).
+
+  @author Michał Napiórkowski
+  @date 2021
+*/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdbool.h>
+
+/**
+ * Domyślna maksymalna głębokość zagnieżdżenia zapisywanych przedziałów.
+ */
+#define TRACE_DEFAULT_DEPTH 8
+
+/**
+ * Kategoria przedziałów parsowania wierszy.
+ */
+#define TRACE_PARSE "parse"
+
+/**
+ * Kategoria przedziałów wykonywania wierszy.
+ */
+#define TRACE_EXECUTE "execute"
+
+/**
+ * Kategoria przedziałów operacji biblioteki Poly.
+ */
+#define TRACE_POLY "poly"
+
+/**
+ * To jest struktura opisująca otwarty przedział czasu.
+ */
+typedef struct TraceSpan {
+    long long start_ns; ///< czas rozpoczęcia w nanosekundach
+    bool recorded; ///< czy przedział zostanie zapisany
+} TraceSpan;
+
+/**
+ * Czy zapis przebiegu jest włączony?
+ */
+extern bool trace_enabled;
+
+/**
+ * Rozpoczyna zapis przebiegu do pliku.
+ * @param[in] path : ścieżka pliku
+ * @param[in] max_depth : maksymalna głębokość zagnieżdżenia zapisywanych
+ * przedziałów; głębsze przedziały są pomijane
+ * @return czy udało się otworzyć plik
+ */
+bool TraceOpen(const char *path, int max_depth);
+
+/**
+ * Kończy zapis przebiegu i zamyka plik.
+ */
+void TraceClose(void);
+
+/**
+ * Funkcja pomocnicza dla TraceBegin, wywoływana przy włączonym zapisie.
+ * @return otwarty przedział
+ */
+TraceSpan TraceBeginEnabled(void);
+
+/**
+ * Funkcja pomocnicza dla TraceEnd, wywoływana przy włączonym zapisie.
+ * @param[in] span : otwarty przedział
+ * @param[in] name : nazwa przedziału
+ * @param[in] category : kategoria przedziału
+ * @param[in] line : nr wiersza lub 0, jeśli przedział nie dotyczy wiersza
+ */
+void TraceEndEnabled(const TraceSpan *span, const char *name,
+                     const char *category, int line);
+
+/**
+ * Otwiera przedział czasu. Przy wyłączonym zapisie kosztuje jedno
+ * porównanie.
+ * @return otwarty przedział
+ */
+static inline TraceSpan TraceBegin(void) {
+    if (!trace_enabled)
+        return (TraceSpan) {0, false};
+    return TraceBeginEnabled();
+}
+
+/**
+ * Zamyka przedział czasu otwarty przez TraceBegin i zapisuje go,
+ * jeśli nie jest zbyt głęboko zagnieżdżony.
+ * @param[in] span : otwarty przedział
+ * @param[in] name : nazwa przedziału
+ * @param[in] category : kategoria przedziału
+ * @param[in] line : nr wiersza lub 0, jeśli przedział nie dotyczy wiersza
+ */
+static inline void TraceEnd(const TraceSpan *span, const char *name,
+                            const char *category, int line) {
+    if (trace_enabled)
+        TraceEndEnabled(span, name, category, line);
+}
+
+#endif //TRACE_H